@@ -47,6 +47,13 @@ static const char rcsid[] = "$Id: am_map.c,v 1.4 1997/02/03 21:24:33 b1 Exp $";
 
 #include "am_map.h"
 
+#ifdef NAOMI_DEBUG
+#include <stdint.h>
+
+// Defined in main.c, for measuring automap drawing.
+uint64_t _get_time();
+#endif
+
 
 // For use if I do walls with outsides/insides
 #define REDS		(256-5*16)
@@ -1110,6 +1117,120 @@ void AM_drawGrid(int color)
 
 }
 
+//
+// Line cache.
+// Clipping every line in the level each frame is most of what
+//  the automap costs, and the result only changes when the
+//  window pans or zooms. So lines are clipped once per window,
+//  mapped or not, and later frames only pick colors and draw.
+// The blockmap narrows down which lines can reach the window.
+//
+typedef struct
+{
+    int		line;
+    fline_t	fl;
+} amline_t;
+
+typedef struct
+{
+    fixed_t	x, y, x2, y2;
+    fixed_t	scale;
+    int		fx, fy, fw, fh;
+} amwindow_t;
+
+static amline_t*	amlines;	// lines reaching the window, clipped
+static int		numamlines;
+static unsigned int*	amcandidates;	// a bit per line in the window's blocks
+static amwindow_t	amwindow;	// the window they were clipped for
+
+#ifdef NAOMI_DEBUG
+int am_drawer_us;
+int am_cached_lines;
+int am_reclips;
+#endif
+
+
+//
+// Clips the lines for the current window, unless it
+// hasn't changed since they last were.
+//
+void AM_cacheLines(void)
+{
+    amwindow_t window;
+    static mline_t l;
+    unsigned int bits;
+    short* list;
+    int bx, by, bx1, by1, bx2, by2;
+    int i, word;
+
+    memset(&window, 0, sizeof(window));
+    window.x = m_x;
+    window.y = m_y;
+    window.x2 = m_x2;
+    window.y2 = m_y2;
+    window.scale = scale_mtof;
+    window.fx = f_x;
+    window.fy = f_y;
+    window.fw = f_w;
+    window.fh = f_h;
+
+    // freed along with the level, which empties the cache too
+    if (!amlines)
+    {
+	amlines = Z_Malloc(numlines*sizeof(*amlines), PU_LEVEL, &amlines);
+	amcandidates = Z_Malloc(((numlines+31)/32)*sizeof(*amcandidates),
+				PU_LEVEL, &amcandidates);
+    }
+    else if (!memcmp(&window, &amwindow, sizeof(window)))
+	return;
+
+    amwindow = window;
+
+    // gather the lines in blocks the window touches
+    memset(amcandidates, 0, ((numlines+31)/32)*sizeof(*amcandidates));
+
+    bx1 = (m_x - bmaporgx)>>MAPBLOCKSHIFT;
+    bx2 = (m_x2 - bmaporgx)>>MAPBLOCKSHIFT;
+    by1 = (m_y - bmaporgy)>>MAPBLOCKSHIFT;
+    by2 = (m_y2 - bmaporgy)>>MAPBLOCKSHIFT;
+
+    if (bx1 < 0) bx1 = 0;
+    if (by1 < 0) by1 = 0;
+    if (bx2 >= bmapwidth) bx2 = bmapwidth-1;
+    if (by2 >= bmapheight) by2 = bmapheight-1;
+
+    for (by=by1;by<=by2;by++)
+    {
+	for (bx=bx1;bx<=bx2;bx++)
+	{
+	    list = blockmaplump + blockmap[by*bmapwidth+bx];
+	    for ( ; *list != -1 ; list++)
+		amcandidates[*list>>5] |= 1u << (*list&31);
+	}
+    }
+
+    // clip them in line order, so overlaps draw as before
+    numamlines = 0;
+    for (word=0;word<(numlines+31)/32;word++)
+    {
+	for (bits=amcandidates[word];bits;bits&=bits-1)
+	{
+	    i = word*32 + __builtin_ctz(bits);
+	    l.a.x = lines[i].v1->x;
+	    l.a.y = lines[i].v1->y;
+	    l.b.x = lines[i].v2->x;
+	    l.b.y = lines[i].v2->y;
+	    if (AM_clipMline(&l, &amlines[numamlines].fl))
+		amlines[numamlines++].line = i;
+	}
+    }
+
+#ifdef NAOMI_DEBUG
+    am_reclips++;
+#endif
+}
+
+
 //
 // Determines visible lines, draws them.
 // This is LineDef based, not LineSeg based.
@@ -1117,51 +1238,56 @@ void AM_drawGrid(int color)
 void AM_drawWalls(void)
 {
     int i;
-    static mline_t l;
+    line_t* line;
+    fline_t* fl;
+
+    AM_cacheLines();
 
-    for (i=0;i<numlines;i++)
+    for (i=0;i<numamlines;i++)
     {
-	l.a.x = lines[i].v1->x;
-	l.a.y = lines[i].v1->y;
-	l.b.x = lines[i].v2->x;
-	l.b.y = lines[i].v2->y;
-	if (cheating || (lines[i].flags & ML_MAPPED))
+	line = &lines[amlines[i].line];
+	fl = &amlines[i].fl;
+	if (cheating || (line->flags & ML_MAPPED))
 	{
-	    if ((lines[i].flags & LINE_NEVERSEE) && !cheating)
+	    if ((line->flags & LINE_NEVERSEE) && !cheating)
 		continue;
-	    if (!lines[i].backsector)
+	    if (!line->backsector)
 	    {
-		AM_drawMline(&l, WALLCOLORS+lightlev);
+		AM_drawFline(fl, WALLCOLORS+lightlev);
 	    }
 	    else
 	    {
-		if (lines[i].special == 39)
+		if (line->special == 39)
 		{ // teleporters
-		    AM_drawMline(&l, WALLCOLORS+WALLRANGE/2);
+		    AM_drawFline(fl, WALLCOLORS+WALLRANGE/2);
 		}
-		else if (lines[i].flags & ML_SECRET) // secret door
+		else if (line->flags & ML_SECRET) // secret door
 		{
-		    if (cheating) AM_drawMline(&l, SECRETWALLCOLORS + lightlev);
-		    else AM_drawMline(&l, WALLCOLORS+lightlev);
+		    if (cheating) AM_drawFline(fl, SECRETWALLCOLORS + lightlev);
+		    else AM_drawFline(fl, WALLCOLORS+lightlev);
 		}
-		else if (lines[i].backsector->floorheight
-			   != lines[i].frontsector->floorheight) {
-		    AM_drawMline(&l, FDWALLCOLORS + lightlev); // floor level change
+		else if (line->backsector->floorheight
+			   != line->frontsector->floorheight) {
+		    AM_drawFline(fl, FDWALLCOLORS + lightlev); // floor level change
 		}
-		else if (lines[i].backsector->ceilingheight
-			   != lines[i].frontsector->ceilingheight) {
-		    AM_drawMline(&l, CDWALLCOLORS+lightlev); // ceiling level change
+		else if (line->backsector->ceilingheight
+			   != line->frontsector->ceilingheight) {
+		    AM_drawFline(fl, CDWALLCOLORS+lightlev); // ceiling level change
 		}
 		else if (cheating) {
-		    AM_drawMline(&l, TSWALLCOLORS+lightlev);
+		    AM_drawFline(fl, TSWALLCOLORS+lightlev);
 		}
 	    }
 	}
 	else if (plr->powers[pw_allmap])
 	{
-	    if (!(lines[i].flags & LINE_NEVERSEE)) AM_drawMline(&l, GRAYS+3);
+	    if (!(line->flags & LINE_NEVERSEE)) AM_drawFline(fl, GRAYS+3);
 	}
     }
+
+#ifdef NAOMI_DEBUG
+    am_cached_lines = numamlines;
+#endif
 }
 
 
@@ -1333,6 +1459,10 @@ void AM_Drawer (void)
 {
     if (!automapactive) return;
 
+#ifdef NAOMI_DEBUG
+    uint64_t starttime = _get_time();
+#endif
+
     AM_clearFB(BACKGROUND);
     if (grid)
 	AM_drawGrid(GRIDCOLORS);
@@ -1346,4 +1476,8 @@ void AM_Drawer (void)
 
     V_MarkRect(f_x, f_y, f_w, f_h);
 
+#ifdef NAOMI_DEBUG
+    am_drawer_us = (int)(_get_time() - starttime);
+#endif
+
 }
@@ -106,6 +106,8 @@ boolean         fastparm;	// checkparm of -fast
 boolean         drone;
 
 boolean		singletics = false; // debug flag to cancel adaptiveness
+boolean		uncappedframes;	// draw between tics, set by the video device
+boolean		hudoverlay;	// menus on their own layer, set by the video device
 
 
 
@@ -196,6 +198,36 @@ extern  boolean setsizeneeded;
 extern  int             showMessages;
 void R_ExecuteSetViewSize (void);
 
+// a melt in progress, run a step at a time by D_Display
+//  so the game keeps going underneath it
+static boolean		wipeactive = false;
+static int		wipestart;
+
+//
+// D_RunWipe
+// Advances the melt by however many tics went by since the
+//  last step, and puts it on the screen.
+//
+static void D_RunWipe (void)
+{
+    int				nowtime;
+    int				tics;
+
+    nowtime = I_GetTime ();
+    tics = nowtime - wipestart;
+    if (tics > 0)
+    {
+	wipestart = nowtime;
+	wipeactive = !wipe_ScreenWipe(wipe_Melt
+				      , 0, 0, SCREENWIDTH, SCREENHEIGHT, tics);
+    }
+    I_UpdateNoBlit ();
+    I_BeginOverlay ();
+    M_Drawer ();                            // menu is drawn even on top of wipes
+    I_EndOverlay ();
+    I_FinishUpdate ();                      // page flip or blit buffer
+}
+
 void D_Display (void)
 {
     static  boolean		viewactivestate = false;
@@ -204,16 +236,19 @@ void D_Display (void)
     static  boolean		fullscreen = false;
     static  gamestate_t		oldgamestate = -1;
     static  int			borderdrawcount;
-    int				nowtime;
-    int				tics;
-    int				wipestart;
     int				y;
-    boolean			done;
     boolean			wipe;
     boolean			redrawsbar;
 
     if (nodrawers)
 	return;                    // for comparative timing / profiling
+
+    // nothing else gets drawn until the melt is done
+    if (wipeactive)
+    {
+	D_RunWipe ();
+	return;
+    }
 		
     redrawsbar = false;
     
@@ -234,7 +269,8 @@ void D_Display (void)
     else
 	wipe = false;
 
-    if (gamestate == GS_LEVEL && gametic)
+    // nothing to erase when the messages weren't drawn on the screen
+    if (gamestate == GS_LEVEL && gametic && !hudoverlay)
 	HU_Erase();
     
     // do buffered drawing
@@ -245,12 +281,12 @@ void D_Display (void)
 	    break;
 	if (automapactive)
 	    AM_Drawer ();
-	if (wipe || (viewheight != 200 && fullscreen) )
+	if (wipe || (scaledviewheight != 200 && fullscreen) )
 	    redrawsbar = true;
 	if (inhelpscreensstate && !inhelpscreens)
 	    redrawsbar = true;              // just put away the help screen
-	ST_Drawer (viewheight == 200, redrawsbar );
-	fullscreen = viewheight == 200;
+	ST_Drawer (scaledviewheight == 200, redrawsbar );
+	fullscreen = scaledviewheight == 200;
 	break;
 
       case GS_INTERMISSION:
@@ -274,7 +310,11 @@ void D_Display (void)
 	R_RenderPlayerView (&players[displayplayer]);
 
     if (gamestate == GS_LEVEL && gametic)
+    {
+	I_BeginOverlay ();
 	HU_Drawer ();
+	I_EndOverlay ();
+    }
     
     // clean up border stuff
     if (gamestate != oldgamestate && gamestate != GS_LEVEL)
@@ -290,7 +330,8 @@ void D_Display (void)
     // see if the border needs to be updated to the screen
     if (gamestate == GS_LEVEL && !automapactive && scaledviewwidth != 320)
     {
-	if (menuactive || menuactivestate || !viewactivestate)
+	if (((menuactive || menuactivestate) && !hudoverlay)
+	    || !viewactivestate)
 	    borderdrawcount = 3;
 	if (borderdrawcount)
 	{
@@ -305,6 +346,8 @@ void D_Display (void)
     inhelpscreensstate = inhelpscreens;
     oldgamestate = wipegamestate = gamestate;
     
+    I_BeginOverlay ();
+
     // draw pause pic
     if (paused)
     {
@@ -319,6 +362,7 @@ void D_Display (void)
 
     // menus go directly to the screen
     M_Drawer ();          // menu is drawn even on top of everything
+    I_EndOverlay ();
     NetUpdate ();         // send out any new accumulation
 
 
@@ -329,25 +373,13 @@ void D_Display (void)
 	return;
     }
     
-    // wipe update
+    // wipe update, the rest of it happens over the next few
+    //  calls while the game runs
     wipe_EndScreen(0, 0, SCREENWIDTH, SCREENHEIGHT);
 
     wipestart = I_GetTime () - 1;
-
-    do
-    {
-	do
-	{
-	    nowtime = I_GetTime ();
-	    tics = nowtime - wipestart;
-	} while (!tics);
-	wipestart = nowtime;
-	done = wipe_ScreenWipe(wipe_Melt
-			       , 0, 0, SCREENWIDTH, SCREENHEIGHT, tics);
-	I_UpdateNoBlit ();
-	M_Drawer ();                            // menu is drawn even on top of wipes
-	I_FinishUpdate ();                      // page flip or blit buffer
-    } while (!done);
+    wipeactive = true;
+    D_RunWipe ();
 }
 
 
@@ -397,6 +429,11 @@ void D_DoomLoop (void)
 		
 	S_UpdateSounds (players[consoleplayer].mo);// move positional sounds
 
+#ifdef NAOMI
+	// Lets the sound device latch its per-tic statistics.
+	I_UpdateSound();
+#endif
+
 	// Update display, next frame, with current state.
 	D_Display ();
 
@@ -34,6 +34,16 @@ static const char rcsid[] = "$Id: d_net.c,v 1.3 1997/02/03 22:01:47 b1 Exp $";
 #include "doomdef.h"
 #include "doomstat.h"
 
+#ifdef NAOMI
+#include <stdint.h>
+
+// Defined in main.c, for measuring idle time.
+uint64_t _get_time();
+
+// Time spent waiting for new tics, for the resolution governor.
+int		net_wait_us;
+#endif
+
 #define	NCMD_EXIT		0x80000000
 #define	NCMD_RETRANSMIT		0x40000000
 #define	NCMD_SETUP		0x20000000
@@ -659,6 +669,11 @@ void TryRunTics (void)
 	}
     }
     availabletics = lowtic - gametic/ticdup;
+
+    // Frames are drawn between tics when uncapped,
+    //  so don't wait around for the next one.
+    if (uncappedframes && availabletics < 1)
+	return;
     
     // decide how many tics to run
     if (realtics < availabletics-1)
@@ -706,6 +721,10 @@ void TryRunTics (void)
 	}
     }// demoplayback
 	
+#ifdef NAOMI
+    uint64_t	waitstart = _get_time();
+#endif
+
     // wait for new tics if needed
     while (lowtic < gametic/ticdup + counts)	
     {
@@ -722,10 +741,17 @@ void TryRunTics (void)
 	// don't stay in here forever -- give the menu a chance to work
 	if (I_GetTime ()/ticdup - entertic >= 20)
 	{
+#ifdef NAOMI
+	    net_wait_us += (int)(_get_time() - waitstart);
+#endif
 	    M_Ticker ();
 	    return;
 	} 
     }
+
+#ifdef NAOMI
+    net_wait_us += (int)(_get_time() - waitstart);
+#endif
     
     // run the count * ticdup dics
     while (counts--)
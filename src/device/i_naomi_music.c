@@ -7,9 +7,43 @@
 #define INVALID_HANDLE -1
 #define SAMPLELENGTH 16384
 #define SILENCELENGTH 2048
-#define SAMPLERATE 44100
 #define MAX_VOLUME 15
 
+// Music quality settings, as chosen in the test menu. Auto starts at the
+// highest tier and steps down when the music thread can't keep up.
+#define MUSIC_QUALITY_AUTO 0
+#define MUSIC_QUALITY_HIGH 1
+#define MUSIC_QUALITY_MEDIUM 2
+#define MUSIC_QUALITY_LOW 3
+#define MUSIC_QUALITY_LOWEST 4
+
+typedef struct
+{
+    char *name;
+    int samplerate;
+    int channels;
+} music_tier_t;
+
+// Synthesis cost scales with output rate, and mono output skips the
+// per-voice panning mix entirely in libtimidity.
+static music_tier_t tiers[] = {
+    { "High", 44100, 2 },
+    { "Medium", 32000, 2 },
+    { "Low", 22050, 2 },
+    { "Lowest", 22050, 1 },
+};
+
+#define NUM_TIERS (sizeof(tiers) / sizeof(tiers[0]))
+
+// Thresholds for automatic tier selection. The buffer empty percentage
+// should hover around 25% when we keep up, so anything much higher means
+// we were late refilling. Hysteresis keeps us from bouncing between tiers.
+#define AUTO_CPU_DOWNGRADE 0.40
+#define AUTO_CPU_UPGRADE 0.15
+#define AUTO_EMPTY_DOWNGRADE 0.60
+#define AUTO_DOWNGRADE_WAKEUPS 8
+#define AUTO_UPGRADE_WAKEUPS 200
+
 typedef struct
 {
     int handle;
@@ -41,16 +75,34 @@ static int global_count = 1;
 static play_instructions_t instructions;
 static uint32_t *buffer;
 static uint32_t *silence;
+static int16_t *monobuffer;
 
 // How many samples out of the total did we write last wake-up.
 float percent_empty = 0.0;
 
+// Fraction of wall time the music thread spent synthesizing last wake-up.
+float music_cpu_share = 0.0;
+
+// Current quality tier index into tiers[], sticky across songs in auto mode.
+int music_tier = 0;
+
 // Defined in menu, for determining if we're in-game or not.
 int M_InGame();
 
 // Defined in main.c, for determining if we should be silent during attract sequences.
 int naomi_get_silent_attract();
 
+// Defined in main.c, for picking a music quality tier.
+int naomi_get_music_quality();
+
+// Defined in main.c, for measuring synthesis time.
+uint64_t _get_time();
+
+char *music_tier_name()
+{
+    return tiers[music_tier].name;
+}
+
 // Specifically so errors aren't annoying to display.
 void _pauseAnySong()
 {
@@ -90,10 +142,8 @@ void audio_set_music_volume()
     }
 }
 
-void *audiothread_music(void *param)
+static MidSong *_load_song(play_instructions_t *inst, music_tier_t *tier)
 {
-    play_instructions_t *inst = (play_instructions_t *)param;
-
     MidIStream *stream = mid_istream_open_mem (inst->data, inst->size);
     if (stream == NULL)
     {
@@ -101,41 +151,124 @@ void *audiothread_music(void *param)
     }
 
     MidSongOptions options;
-    options.rate = SAMPLERATE;
+    options.rate = tier->samplerate;
     options.format = MID_AUDIO_S16LSB;
-    options.channels = 2;
+    options.channels = tier->channels;
     options.buffer_size = SAMPLELENGTH;
 
-    // Now that we're ready to go, set our priority high so we don't stutter.
-    thread_priority(instructions.thread, 2);
-
     MidSong *song = mid_song_load (stream, &options);
     mid_istream_close (stream);
 
+    if (song != NULL)
+    {
+        mid_song_set_volume(song, 150);
+    }
+
+    return song;
+}
+
+static int _read_song(MidSong *song, music_tier_t *tier)
+{
+    if (tier->channels == 2)
+    {
+        return mid_song_read_wave(song, (void *)buffer, SAMPLELENGTH * 4) / 4;
+    }
+
+    // Synthesize in mono, and then duplicate each sample to both speakers
+    // since the ringbuffer is always stereo.
+    int numsamples = mid_song_read_wave(song, (void *)monobuffer, SAMPLELENGTH * 2) / 2;
+    for (int i = 0; i < numsamples; i++)
+    {
+        uint32_t sample = (uint16_t)monobuffer[i];
+        buffer[i] = (sample << 16) | sample;
+    }
+
+    return numsamples;
+}
+
+static int _pick_tier(int cur_tier, int *over, int *under)
+{
+    int quality = naomi_get_music_quality();
+    if (quality != MUSIC_QUALITY_AUTO)
+    {
+        // Operator forced a particular tier in the test menu.
+        *over = 0;
+        *under = 0;
+        return quality - MUSIC_QUALITY_HIGH;
+    }
+
+    if (music_cpu_share > AUTO_CPU_DOWNGRADE || percent_empty > AUTO_EMPTY_DOWNGRADE)
+    {
+        *under = 0;
+        if (++(*over) >= AUTO_DOWNGRADE_WAKEUPS && cur_tier < (int)(NUM_TIERS - 1))
+        {
+            *over = 0;
+            return cur_tier + 1;
+        }
+    }
+    else if (music_cpu_share < AUTO_CPU_UPGRADE)
+    {
+        *over = 0;
+        if (++(*under) >= AUTO_UPGRADE_WAKEUPS && cur_tier > 0)
+        {
+            *under = 0;
+            return cur_tier - 1;
+        }
+    }
+    else
+    {
+        *over = 0;
+        *under = 0;
+    }
+
+    return cur_tier;
+}
+
+void *audiothread_music(void *param)
+{
+    play_instructions_t *inst = (play_instructions_t *)param;
+
+    int quality = naomi_get_music_quality();
+    if (quality != MUSIC_QUALITY_AUTO)
+    {
+        music_tier = quality - MUSIC_QUALITY_HIGH;
+    }
+    music_tier_t *tier = &tiers[music_tier];
+
+    // Now that we're ready to go, set our priority high so we don't stutter.
+    thread_priority(instructions.thread, 2);
+
+    MidSong *song = _load_song(inst, tier);
     if (song == NULL)
     {
         return NULL;
     }
 
-    mid_song_set_volume(song, 150);
     mid_song_start(song);
 
     // Specifically want to wake up before its our time to fill the buffer again,
     // so we leave ourselves room for 1/4 of the buffer to have filled. If you
     // turn on debugging, you should see the buf empty percent hover around 25%.
-    int sleep_us = (int)(1000000.0 * ((float)SAMPLELENGTH / (float)SAMPLERATE) * (1.0 / 4.0));
+    int sleep_us = (int)(1000000.0 * ((float)SAMPLELENGTH / (float)tier->samplerate) * (1.0 / 4.0));
     int written = 0;
 
-    audio_register_ringbuffer(AUDIO_FORMAT_16BIT, SAMPLERATE, SAMPLELENGTH);
+    // Bookkeeping for how much time we spend synthesizing versus sleeping.
+    uint64_t synth_us = 0;
+    uint64_t window_start = _get_time();
+    int over = 0;
+    int under = 0;
+
+    audio_register_ringbuffer(AUDIO_FORMAT_16BIT, tier->samplerate, SAMPLELENGTH);
     audio_set_music_volume();
 
     while (inst->exit == 0)
     {
-        int bytes_read;
-        while (inst->exit == 0 && (bytes_read = mid_song_read_wave(song, (void *)buffer, SAMPLELENGTH * 4)))
+        int numsamples;
+        uint64_t synth_start = _get_time();
+        while (inst->exit == 0 && (numsamples = _read_song(song, tier)))
         {
-            int numsamples = bytes_read / 4;
             uint32_t *samples = buffer;
+            synth_us += _get_time() - synth_start;
 
             while (numsamples > 0 && inst->exit == 0)
             {
@@ -176,6 +309,42 @@ void *audiothread_music(void *param)
                         percent_empty = (float)written / (float)SAMPLELENGTH;
                         written = 0;
 
+                        // Work out how much of our time since the last wake-up went to synthesis.
+                        uint64_t now = _get_time();
+                        if (now > window_start)
+                        {
+                            music_cpu_share = (float)synth_us / (float)(now - window_start);
+                        }
+                        synth_us = 0;
+                        window_start = now;
+
+                        int new_tier = _pick_tier(music_tier, &over, &under);
+                        if (new_tier != music_tier)
+                        {
+                            // Reload the song at the new rate, picking back up where we were.
+                            uint32_t position = mid_song_get_time(song);
+                            MidSong *new_song = _load_song(inst, &tiers[new_tier]);
+                            if (new_song != NULL)
+                            {
+                                mid_song_free(song);
+                                song = new_song;
+                                mid_song_start(song);
+                                mid_song_seek(song, position);
+
+                                music_tier = new_tier;
+                                tier = &tiers[music_tier];
+                                sleep_us = (int)(1000000.0 * ((float)SAMPLELENGTH / (float)tier->samplerate) * (1.0 / 4.0));
+
+                                // Whatever is left of the old rate's samples would play back at
+                                // the wrong speed, so drop them and start over.
+                                audio_unregister_ringbuffer();
+                                audio_register_ringbuffer(AUDIO_FORMAT_16BIT, tier->samplerate, SAMPLELENGTH);
+                                audio_set_music_volume();
+                                numsamples = 0;
+                                break;
+                            }
+                        }
+
                         // Sleep for the time it takes to play half our buffer so we can wake up and
                         // fill it again.
                         thread_sleep(sleep_us);
@@ -186,6 +355,8 @@ void *audiothread_music(void *param)
                     }
                 }
             }
+
+            synth_start = _get_time();
         }
 
         if (inst->exit == 0)
@@ -214,6 +385,7 @@ void I_InitMusic(void)
     }
 
     buffer = malloc(SAMPLELENGTH * 4);
+    monobuffer = malloc(SAMPLELENGTH * 2);
     silence = malloc(SILENCELENGTH * 4);
     memset(silence, 0, SILENCELENGTH * 4);
 
@@ -253,6 +425,7 @@ void I_ShutdownMusic(void)
         reglist_count = 0;
 
         free(buffer);
+        free(monobuffer);
         free(silence);
     }
 
@@ -1,103 +1,333 @@
 #include <stdlib.h>
+#include <stdint.h>
 #include <naomi/audio.h>
 #include "../i_sound.h"
 #include "../w_wad.h"
 #include "../z_zone.h"
 
 #define PAN_SCALE 128.0
+#define SFX_SAMPLERATE 11025
+
+// How far apart (in volume steps) the left and right levels can be before a
+// sound needs a voice per speaker instead of one voice panned center.
+#define PAN_TOLERANCE 1
+
+// Sound effect sample data, one per distinct WAD lump. Linked sfx and sfx
+// that fall back to dspistol all share a single entry. Samples are only
+// uploaded to the AICA the first time they're played, and the least recently
+// used ones are kicked out again if sound RAM runs out.
+typedef struct {
+    int lumpnum;
+    int handle;
+    int samplerate;
+    int length;
+    int bytes;
+    uint64_t lastused;
+} sfx_sample_t;
+
+sfx_sample_t samples[NUMSFX];
+int numsamples = 0;
 
 // So we can link between SFX and AICA-registered sound effects.
 typedef struct {
     sfxinfo_t *sfx;
-    int handle;
+    int sample;
 } audio_link_t;
 
 audio_link_t links[NUMSFX];
 
+// Sample storage counters, shown in the debug overlay.
+int sfx_aica_bytes = 0;
+int sfx_aica_samples = 0;
+int sfx_aica_evictions = 0;
+
+#if defined(NAOMI_SFX_ADPCM) && defined(AUDIO_FORMAT_4BIT)
+// Store samples as 4-bit Yamaha ADPCM, which the AICA decodes for free, to fit
+// twice as many sounds in sound RAM at some cost in fidelity.
+#define SFX_ADPCM 1
+#endif
+
 typedef struct
 {
+    // Handle given back to s_sound.c. The low bits are the slot index so that
+    // lookups don't need to scan, and the rest is a serial number so stale
+    // handles for a reused slot don't match.
+    int handle;
+
+    // Instance handles for each speaker. Sounds near the center of the
+    // stereo field play on a single voice in leftchan, and rightchan is 0.
     int leftchan;
     int rightchan;
     int override;
+
+    // Last volume levels we sent to the hardware, so that updates only go
+    // out over the G2 bus when something actually changed.
+    int leftlevel;
+    int rightlevel;
+
+    // What we need to decide who gets kicked out when we're full. Lower
+    // priority values are more important, same as S_sfx. Volume already
+    // has distance attenuation applied by S_AdjustSoundParams.
+    int priority;
+    int vol;
+
+    // Which sample this is playing, so we don't evict it out from under the AICA.
+    int sample;
+
+    // When the sample will have finished playing, so we never have to ask
+    // the AICA whether a voice is still busy.
+    uint64_t ends;
 } sound_t;
 
-// Number of active sounds we are tracking.
+// Number of active sounds we are tracking. Must be a power of two.
 #define MAX_SOUNDS 32
+#define SOUND_SLOT_BITS 5
 sound_t sounds[MAX_SOUNDS];
+static int sound_serial = 0;
 
-static void _load_sfx(sfxinfo_t *sfxInfo)
+// Voice usage counters, shown in the debug overlay.
+int sfx_voices_used = 0;
+int sfx_voices_peak = 0;
+int sfx_voices_stolen = 0;
+int sfx_voices_dropped = 0;
+int sfx_hw_voices = 0;
+
+// Per-tic update counters, latched in I_UpdateSound.
+int sfx_updates_per_tic = 0;
+int sfx_writes_per_tic = 0;
+static int sfx_updates = 0;
+static int sfx_writes = 0;
+
+// Defined in main.c, for voice lifetime tracking.
+uint64_t _get_time();
+
+#ifdef SFX_ADPCM
+static const int adpcm_diff[16] = { 1, 3, 5, 7, 9, 11, 13, 15, -1, -3, -5, -7, -9, -11, -13, -15 };
+static const int adpcm_scale[8] = { 0x0e6, 0x0e6, 0x0e6, 0x0e6, 0x133, 0x199, 0x200, 0x266 };
+
+static int _adpcm_encode_nibble(int sample, int *signal, int *step)
 {
-    // First, grab the lump itself.
-    int lumpNum = I_GetSfxLumpNum(sfxInfo);
+    int diff = ((sample - *signal) * 8) / *step;
+    int val = abs(diff) / 2;
+    if (val > 7) { val = 7; }
+    if (diff < 0) { val += 8; }
+
+    *signal += (*step * adpcm_diff[val]) / 8;
+    if (*signal > 32767) { *signal = 32767; }
+    if (*signal < -32768) { *signal = -32768; }
+
+    *step = (*step * adpcm_scale[val & 7]) >> 8;
+    if (*step < 0x7f) { *step = 0x7f; }
+    if (*step > 0x6000) { *step = 0x6000; }
+
+    return val;
+}
+
+// Converts unsigned 8-bit WAD samples to AICA ADPCM, two samples per byte with
+// the first sample in the low nibble.
+static unsigned char *_convert_sfx(unsigned char *data, int length, int *bytes)
+{
+    int signal = 0;
+    int step = 0x7f;
+
+    *bytes = (length + 1) / 2;
+    unsigned char *converted = malloc(*bytes);
+
+    for (int i = 0; i < length; i += 2)
+    {
+        int low = _adpcm_encode_nibble((data[i] ^ 0x80) << 8, &signal, &step);
+        int high = (i + 1) < length ? _adpcm_encode_nibble((data[i + 1] ^ 0x80) << 8, &signal, &step) : 0;
+        converted[i / 2] = low | (high << 4);
+    }
+
+    return converted;
+}
+#else
+static unsigned char *_convert_sfx(unsigned char *data, int length, int *bytes)
+{
+    *bytes = length;
+    unsigned char *converted = malloc(length);
+
+    // Convert unsigned to signed, four samples at a time.
+    uint32_t *src = (uint32_t *)data;
+    uint32_t *dst = (uint32_t *)converted;
+    int words = length / 4;
+    for (int i = 0; i < words; i++)
+    {
+        dst[i] = src[i] ^ 0x80808080;
+    }
+    for (int i = words * 4; i < length; i++)
+    {
+        converted[i] = data[i] ^ 0x80;
+    }
+
+    return converted;
+}
+#endif
+
+// Finds or creates the sample entry for a given lump.
+static int _find_sample(int lumpnum)
+{
+    for (int i = 0; i < numsamples; i++)
+    {
+        if (samples[i].lumpnum == lumpnum)
+        {
+            return i;
+        }
+    }
 
     // Grab the size of the SFX.
-    int soundSize = W_LumpLength(lumpNum);
+    int soundSize = W_LumpLength(lumpnum);
     if (soundSize <= 8 || soundSize >= (65535 + 8))
     {
-        printf("Sound effect %s is empty or too large?\n", sfxInfo->name);
-        sfxInfo->data = NULL;
-        sfxInfo->length = 0;
+        return -1;
+    }
+
+    sfx_sample_t *sample = &samples[numsamples];
+    sample->lumpnum = lumpnum;
+    sample->handle = 0;
+    sample->samplerate = SFX_SAMPLERATE;
+    sample->length = soundSize - 8;
+    sample->bytes = 0;
+    sample->lastused = 0;
+
+    return numsamples++;
+}
+
+// Defined below, alongside voice tracking.
+static int _sample_is_playing(int sample, uint64_t now);
+
+// Kicks the least recently used idle sample out of sound RAM. Returns nonzero
+// if something was freed up.
+static int _evict_sample(uint64_t now)
+{
+    sfx_sample_t *victim = NULL;
+
+    for (int i = 0; i < numsamples; i++)
+    {
+        if (samples[i].handle > 0 && !_sample_is_playing(i, now))
+        {
+            if (victim == NULL || samples[i].lastused < victim->lastused)
+            {
+                victim = &samples[i];
+            }
+        }
+    }
+
+    if (victim == NULL)
+    {
+        return 0;
     }
 
-    // Grab actual SFX data, ignore the header.
-    unsigned char *data = W_CacheLumpNum(lumpNum, PU_STATIC);
-    unsigned char *converted = malloc(soundSize - 8);
+    audio_unregister_sound(victim->handle);
+    victim->handle = 0;
+    sfx_aica_bytes -= victim->bytes;
+    sfx_aica_samples--;
+    sfx_aica_evictions++;
+    return 1;
+}
+
+// Makes sure a sample is in sound RAM, uploading it if needed.
+static int _register_sample(int which, uint64_t now)
+{
+    sfx_sample_t *sample = &samples[which];
+    sample->lastused = now;
 
-    for (int i = 0; i < soundSize - 8; i++)
+    if (sample->handle > 0)
     {
-        // Convert unsigned to signed.
-        converted[i] = data[i + 8] ^ 0x80;
+        return sample->handle;
     }
 
+    // Grab actual SFX data. The header holds the sample rate, which is 11025
+    // for everything in the IWADs but not necessarily in PWADs.
+    unsigned char *data = W_CacheLumpNum(sample->lumpnum, PU_STATIC);
+    if (data[2] | (data[3] << 8))
+    {
+        sample->samplerate = data[2] | (data[3] << 8);
+    }
+
+    unsigned char *converted = _convert_sfx(data + 8, sample->length, &sample->bytes);
+
     // No longer need WAD data.
     Z_Free (data);
 
-    // Set it!
-    sfxInfo->data = converted;
-    sfxInfo->length = soundSize - 8;
+    do
+    {
+#ifdef SFX_ADPCM
+        sample->handle = audio_register_sound(AUDIO_FORMAT_4BIT, sample->samplerate, converted, sample->length);
+#else
+        sample->handle = audio_register_sound(AUDIO_FORMAT_8BIT, sample->samplerate, converted, sample->length);
+#endif
+    } while (sample->handle <= 0 && _evict_sample(now));
+
+    // The AICA has its own copy now.
+    free(converted);
+
+    if (sample->handle <= 0)
+    {
+        sample->handle = 0;
+        return 0;
+    }
+
+    sfx_aica_bytes += sample->bytes;
+    sfx_aica_samples++;
+    return sample->handle;
 }
 
 void I_InitSound()
 {
     printf("I_InitSound()\n");
 
-    // Load all sounds, stick them into the AICA for instant playback.
+    uint64_t start = _get_time();
+    int naive_bytes = 0;
+    numsamples = 0;
+
+    // Work out which lump backs every sound, sharing one sample between all
+    // sounds that use the same lump. Nothing is uploaded until first use.
     for (int i = 1; i < NUMSFX; i++)
     {
-        if (!S_sfx[i].link)
-        {
-            // Normal sound file, load from WAD.
-            _load_sfx(&S_sfx[i]);
-        }
-        else
-        {
-            // Link to another sound file, just use that link. Malloc so we
-            // can safely free later.
-            S_sfx[i].data = malloc(S_sfx[i].link->length);
-            memcpy(S_sfx[i].data, S_sfx[i].link->data, S_sfx[i].link->length);
-            S_sfx[i].length = S_sfx[i].link->length;
-        }
+        sfxinfo_t *sfx = S_sfx[i].link ? S_sfx[i].link : &S_sfx[i];
+
+        links[i].sfx = &S_sfx[i];
+        links[i].sample = _find_sample(I_GetSfxLumpNum(sfx));
+
+        // We never need the sample data in main RAM, only its length.
+        S_sfx[i].data = NULL;
+        S_sfx[i].length = 0;
 
-        // Now, register the audio with the AICA.
-        if (S_sfx[i].data)
+        if (links[i].sample >= 0)
         {
-            links[i].sfx = &S_sfx[i];
-            links[i].handle = audio_register_sound(AUDIO_FORMAT_8BIT, 11025, S_sfx[i].data, S_sfx[i].length);
-            printf("Registered %s as AICA handle %d\n", S_sfx[i].name, links[i].handle);
+            S_sfx[i].length = samples[links[i].sample].length;
+            naive_bytes += samples[links[i].sample].length;
         }
         else
         {
-            links[i].sfx = &S_sfx[i];
-            links[i].handle = -1;
+            printf("Sound effect %s is empty or too large?\n", S_sfx[i].name);
         }
     }
 
     memset(sounds, 0, sizeof(sounds));
+    sfx_aica_bytes = 0;
+    sfx_aica_samples = 0;
+    sfx_aica_evictions = 0;
+
+    printf(
+        "Found %d unique sound effects for %d sfx (%d bytes if each were registered) in %d us\n",
+        numsamples,
+        NUMSFX - 1,
+        naive_bytes,
+        (int)(_get_time() - start)
+    );
 }
 
 void I_UpdateSound(void)
 {
-    // Empty.
+    // Called once a frame after positional sounds are moved, so latch the
+    // counters for the debug overlay.
+    sfx_updates_per_tic = sfx_updates;
+    sfx_writes_per_tic = sfx_writes;
+    sfx_updates = 0;
+    sfx_writes = 0;
 }
 
 void I_SubmitSound(void)
@@ -109,12 +339,22 @@ void I_ShutdownSound(void)
 {
     for (int i = 1; i < NUMSFX; i++)
     {
-        free(S_sfx[i].data);
         links[i].sfx = NULL;
+        links[i].sample = -1;
+    }
 
-        audio_unregister_sound(links[i].handle);
-        links[i].handle = 0;
+    for (int i = 0; i < numsamples; i++)
+    {
+        if (samples[i].handle > 0)
+        {
+            audio_unregister_sound(samples[i].handle);
+            samples[i].handle = 0;
+        }
     }
+
+    numsamples = 0;
+    sfx_aica_bytes = 0;
+    sfx_aica_samples = 0;
 }
 
 void I_SetChannels()
@@ -173,125 +413,342 @@ void S_OverrideAttractSetting(int override)
     sound_override = override;
 }
 
-void _bookkeep_sounds()
+static void _free_sound(sound_t *sound)
+{
+    sound->handle = 0;
+    sound->leftchan = 0;
+    sound->rightchan = 0;
+    sound->override = 0;
+    sound->ends = 0;
+}
+
+static void _stop_sound(sound_t *sound)
+{
+    audio_stop_sound_instance(sound->leftchan);
+    if (sound->rightchan != 0)
+    {
+        audio_stop_sound_instance(sound->rightchan);
+    }
+}
+
+// Works out the logtable index for each speaker.
+static void _calc_levels(int vol, int sep, int override, int *leftlevel, int *rightlevel)
+{
+    if (vol < 0) { vol = 0; }
+
+    float rightvol = ((float)sep / PAN_SCALE) * (float)vol;
+    float leftvol = ((float)(255 - sep) / PAN_SCALE) * (float)vol;
+
+    if (leftvol > 15.0) { leftvol = 15.0; }
+    if (rightvol > 15.0) { rightvol = 15.0; }
+
+    if (naomi_get_silent_attract() && !M_InGame() && !override)
+    {
+        // Hack to hush up sounds when in attract mode. Make sure we still play
+        // sound effects generated by the menu system regardless.
+        leftvol = 0;
+        rightvol = 0;
+    }
+
+    *leftlevel = (int)leftvol;
+    *rightlevel = (int)rightvol;
+}
+
+static int _levels_centered(int leftlevel, int rightlevel)
+{
+    return abs(leftlevel - rightlevel) <= PAN_TOLERANCE;
+}
+
+static int _sound_is_playing(sound_t *sound, uint64_t now)
+{
+    return sound->leftchan != 0 && now < sound->ends;
+}
+
+static sound_t *_find_sound(int handle)
+{
+    if (handle <= 0)
+    {
+        return NULL;
+    }
+
+    sound_t *sound = &sounds[handle & (MAX_SOUNDS - 1)];
+    return sound->handle == handle ? sound : NULL;
+}
+
+static int _sample_is_playing(int sample, uint64_t now)
 {
     for (int i = 0; i < MAX_SOUNDS; i++)
     {
-        if (sounds[i].leftchan != 0 && !audio_sound_instance_is_playing(sounds[i].leftchan))
+        if (sounds[i].sample == sample && _sound_is_playing(&sounds[i], now))
         {
-            // This sound is dead.
-            sounds[i].leftchan = 0;
-            sounds[i].rightchan = 0;
-            sounds[i].override = 0;
+            return 1;
         }
     }
+
+    return 0;
 }
 
-int I_StartSound(int id, int vol, int sep, int pitch, int priority)
+// Returns nonzero if the sound in a slot is less important than a new
+// sound with the given priority and volume, and can be cut off for it.
+static int _sound_is_less_important(sound_t *sound, int priority, int vol)
 {
-    if (links[id].sfx != NULL && links[id].handle > 0)
+    if (sound->priority != priority)
     {
-        if (vol < 0) { vol = 0; }
+        return sound->priority > priority;
+    }
 
-        // First, clear up any sounds we might have tracked.
-        _bookkeep_sounds();
+    return sound->vol <= vol;
+}
 
-        // Now, calculate panning.
-        float rightvol = ((float)sep / PAN_SCALE) * (float)vol;
-        float leftvol = ((float)(255 - sep) / PAN_SCALE) * (float)vol;
+static sound_t *_allocate_sound(int priority, int vol)
+{
+    uint64_t now = _get_time();
+    sound_t *victim = NULL;
+    int used = 0;
+    int hw_voices = 0;
 
-        if (leftvol > 15.0) { leftvol = 15.0; }
-        if (rightvol > 15.0) { rightvol = 15.0; }
+    for (int i = 0; i < MAX_SOUNDS; i++)
+    {
+        sound_t *sound = &sounds[i];
+        if (!_sound_is_playing(sound, now))
+        {
+            // This sound is dead, or was never alive.
+            if (sound->leftchan != 0)
+            {
+                _free_sound(sound);
+            }
+            continue;
+        }
+
+        used++;
+        hw_voices += sound->rightchan != 0 ? 2 : 1;
+
+        // Menu sounds are never stolen.
+        if (sound->override)
+        {
+            continue;
+        }
 
+        // Track the least important voice, preferring the one closest to
+        // finishing on ties so that the cut is least noticeable.
+        if (
+            victim == NULL ||
+            sound->priority > victim->priority ||
+            (sound->priority == victim->priority && sound->vol < victim->vol) ||
+            (sound->priority == victim->priority && sound->vol == victim->vol && sound->ends < victim->ends)
+        )
+        {
+            victim = sound;
+        }
+    }
+
+    sfx_voices_used = used;
+    sfx_hw_voices = hw_voices;
+    if (used > sfx_voices_peak)
+    {
+        sfx_voices_peak = used;
+    }
+
+    if (used < MAX_SOUNDS)
+    {
         for (int i = 0; i < MAX_SOUNDS; i++)
         {
             if (sounds[i].leftchan == 0)
             {
-                if (naomi_get_silent_attract() && !M_InGame() && !sound_override)
-                {
-                    // Hack to hush up sounds when in attract mode. Make sure we still play
-                    // sound effects generated by the menu system regardless.
-                    leftvol = 0;
-                    rightvol = 0;
-                }
-
-                sounds[i].leftchan = audio_play_registered_sound(links[id].handle, SPEAKER_LEFT, logtable[(int)leftvol]);
-                sounds[i].rightchan = audio_play_registered_sound(links[id].handle, SPEAKER_RIGHT, logtable[(int)rightvol]);
-                sounds[i].override = sound_override;
-                return sounds[i].leftchan;
+                return &sounds[i];
             }
         }
     }
 
-    return 0;
+    if (victim != NULL && _sound_is_less_important(victim, priority, vol))
+    {
+        _stop_sound(victim);
+        _free_sound(victim);
+        sfx_voices_stolen++;
+        return victim;
+    }
+
+    sfx_voices_dropped++;
+    return NULL;
 }
 
-void I_StopSound(int handle)
+int I_StartSound(int id, int vol, int sep, int pitch, int priority, int positional)
 {
-    for (int i = 0; i < MAX_SOUNDS; i++)
+    if (links[id].sfx != NULL && links[id].sample >= 0)
     {
-        if (sounds[i].leftchan == handle)
+        uint64_t now = _get_time();
+
+        // Make sure the sample is in sound RAM before we go looking for a voice.
+        int handle = _register_sample(links[id].sample, now);
+        if (handle <= 0)
+        {
+            sfx_voices_dropped++;
+            return 0;
+        }
+
+        if (vol < 0) { vol = 0; }
+
+        // The priority handed to us by S_StartSoundAtVolume is only correct
+        // for linked sounds, so look it up ourselves.
+        priority = links[id].sfx->priority;
+
+        // First, find a slot for this sound, kicking out something less
+        // important if we are full.
+        sound_t *sound = _allocate_sound(priority, vol);
+        if (sound == NULL)
         {
-            if (sounds[i].override)
+            return 0;
+        }
+
+        // Now, calculate panning.
+        int leftlevel;
+        int rightlevel;
+        _calc_levels(vol, sep, sound_override, &leftlevel, &rightlevel);
+
+        if (!positional && _levels_centered(leftlevel, rightlevel))
+        {
+            // Nothing will ever pan this, so one voice on both speakers sounds the same.
+            int level = leftlevel > rightlevel ? leftlevel : rightlevel;
+            sound->leftchan = audio_play_registered_sound(handle, SPEAKER_LEFT | SPEAKER_RIGHT, logtable[level]);
+            sound->rightchan = 0;
+            leftlevel = level;
+            rightlevel = level;
+            sfx_writes++;
+        }
+        else
+        {
+            // Panned, so we need a voice per speaker.
+            sound->leftchan = audio_play_registered_sound(handle, SPEAKER_LEFT, logtable[leftlevel]);
+            sound->rightchan = audio_play_registered_sound(handle, SPEAKER_RIGHT, logtable[rightlevel]);
+            sfx_writes += 2;
+
+            if (sound->rightchan < 0)
             {
-                // Don't stop sounds that are for menu operations.
-                break;
+                sound->rightchan = 0;
             }
-            audio_stop_sound_instance(sounds[i].leftchan);
-            audio_stop_sound_instance(sounds[i].rightchan);
-            sounds[i].leftchan = 0;
-            sounds[i].rightchan = 0;
-            sounds[i].override = 0;
-            break;
         }
+
+        if (sound->leftchan <= 0)
+        {
+            if (sound->rightchan > 0)
+            {
+                audio_stop_sound_instance(sound->rightchan);
+            }
+            _free_sound(sound);
+            sfx_voices_dropped++;
+            return 0;
+        }
+
+        sound->override = sound_override;
+        sound->leftlevel = leftlevel;
+        sound->rightlevel = rightlevel;
+        sound->priority = priority;
+        sound->vol = vol;
+        sound->sample = links[id].sample;
+        sound->ends = now + (((uint64_t)samples[sound->sample].length * 1000000) / samples[sound->sample].samplerate);
+
+        sound_serial = (sound_serial % 0x1FFFFFF) + 1;
+        sound->handle = (sound_serial << SOUND_SLOT_BITS) | (int)(sound - sounds);
+        return sound->handle;
     }
 
-    _bookkeep_sounds();
+    return 0;
 }
 
-int I_SoundIsPlaying(int handle)
+void I_StopSound(int handle)
 {
-    for (int i = 0; i < MAX_SOUNDS; i++)
+    sound_t *sound = _find_sound(handle);
+
+    // Don't stop sounds that are for menu operations.
+    if (sound != NULL && !sound->override)
     {
-        if (sounds[i].leftchan == handle)
+        if (_sound_is_playing(sound, _get_time()))
         {
-            int playing = audio_sound_instance_is_playing(handle);
-            if (!playing)
-            {
-                sounds[i].leftchan = 0;
-                sounds[i].rightchan = 0;
-                sounds[i].override = 0;
-            }
-            return playing;
+            _stop_sound(sound);
         }
+        _free_sound(sound);
     }
-    return 0;
 }
 
-void I_UpdateSoundParams(int handle, int vol, int sep, int pitch)
+int I_SoundIsPlaying(int handle)
 {
-    for (int i = 0; i < MAX_SOUNDS; i++)
+    sound_t *sound = _find_sound(handle);
+    if (sound == NULL)
+    {
+        return 0;
+    }
+
+    int playing = _sound_is_playing(sound, _get_time());
+    if (!playing)
+    {
+        _free_sound(sound);
+    }
+    return playing;
+}
+
+static void _update_sound(sound_t *sound, int vol, int sep)
+{
+    if (vol < 0) { vol = 0; }
+
+    // Remember how loud this is for voice stealing.
+    sound->vol = vol;
+
+    // Update volume and panning.
+    int leftlevel;
+    int rightlevel;
+    _calc_levels(vol, sep, sound->override, &leftlevel, &rightlevel);
+
+    if (sound->rightchan == 0)
     {
-        if (sounds[i].leftchan == handle)
+        // Only sounds that never move get a single voice.
+        int level = leftlevel > rightlevel ? leftlevel : rightlevel;
+
+        if (level != sound->leftlevel)
+        {
+            audio_change_sound_instance_volume(sound->leftchan, logtable[level]);
+            sound->leftlevel = level;
+            sound->rightlevel = level;
+            sfx_writes++;
+        }
+    }
+    else
+    {
+        if (leftlevel != sound->leftlevel)
+        {
+            audio_change_sound_instance_volume(sound->leftchan, logtable[leftlevel]);
+            sound->leftlevel = leftlevel;
+            sfx_writes++;
+        }
+        if (rightlevel != sound->rightlevel)
         {
-            if (vol < 0) { vol = 0; }
+            audio_change_sound_instance_volume(sound->rightchan, logtable[rightlevel]);
+            sound->rightlevel = rightlevel;
+            sfx_writes++;
+        }
+    }
+}
 
-            // Update volume and panning.
-            float rightvol = ((float)sep / PAN_SCALE) * (float)vol;
-            float leftvol = ((float)(255 - sep) / PAN_SCALE) * (float)vol;
+void I_UpdateSoundParams(int handle, int vol, int sep, int pitch)
+{
+    sfx_updates++;
 
-            if (leftvol > 15.0) { leftvol = 15.0; }
-            if (rightvol > 15.0) { rightvol = 15.0; }
+    sound_t *sound = _find_sound(handle);
+    if (sound != NULL)
+    {
+        _update_sound(sound, vol, sep);
+    }
+}
 
-            if (naomi_get_silent_attract() && !M_InGame() && !sounds[i].override)
-            {
-                // Hack to hush up sounds when in attract mode.
-                leftvol = 0;
-                rightvol = 0;
-            }
+void I_UpdateSoundParamsBatch(soundparams_t *params, int count)
+{
+    sfx_updates += count;
 
-            audio_change_sound_instance_volume(sounds[i].leftchan, logtable[(int)leftvol]);
-            audio_change_sound_instance_volume(sounds[i].rightchan, logtable[(int)rightvol]);
+    for (int i = 0; i < count; i++)
+    {
+        sound_t *sound = _find_sound(params[i].handle);
+        if (sound != NULL)
+        {
+            _update_sound(sound, params[i].vol, params[i].sep);
         }
     }
 }
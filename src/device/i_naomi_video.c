@@ -14,10 +14,14 @@
 #include "../v_video.h"
 #include "../m_swap.h"
 #include "../hu_stuff.h"
+#include "../r_local.h"
+#include "../doomstat.h"
+#include "../w_wad.h"
+#include "../z_zone.h"
 
 static uint32_t video_thread = 0;
-static texture_description_t *outtex[2];
-static int whichtex = 0;
+static texture_description_t *viewtex[2];
+static int whichviewtex = 0;
 static float xscale;
 static float yscale;
 static int yoff;
@@ -25,13 +29,290 @@ static int debugxoff;
 static int doom_updates;
 static int started = 0;
 
+// A screen sized layer in VRAM, double buffered, along with the parts each
+// texture is missing, since each one needs the last two frames' worth of changes.
+typedef struct
+{
+    texture_description_t *tex[2];
+    int which;
+    int pendingleft[2][DIRTYBANDS];
+    int pendingright[2][DIRTYBANDS];
+} screen_layer_t;
+
+// The screen itself, with the status bar, automap and everything else drawn
+// in software, and the overlay on top of it with the menus and HUD messages.
+static screen_layer_t screenlayer;
+static screen_layer_t overlaylayer;
+static byte *uploadbuf;
+
+// Finished frames handed from the main thread to the video thread, which does
+// the slow upload to VRAM so the main thread can get on with the next frame.
+// With three buffers there is always one free that isn't the newest finished
+// frame or the one being uploaded.
+#define NUM_HANDOFF 3
+static byte *handoff[NUM_HANDOFF];
+static int handoffpendingleft[NUM_HANDOFF][DIRTYBANDS];
+static int handoffpendingright[NUM_HANDOFF][DIRTYBANDS];
+static volatile int handoff_ready = -1;
+static volatile int handoff_uploading = -1;
+
+// The 3D view, when it was drawn above screen resolution, goes along with the
+// rest of the frame and is composited under it by the hardware.
+typedef struct
+{
+    // Whether this frame has a view to show at all.
+    int drawn;
+
+    // Where it goes on the screen, in SCREENWIDTH x SCREENHEIGHT.
+    int x;
+    int y;
+    int width;
+    int height;
+
+    // How big it actually is.
+    int renderwidth;
+    int renderheight;
+} view_layer_t;
+
+static view_layer_t handoffview[NUM_HANDOFF];
+static byte *handoffviewbuf[NUM_HANDOFF];
+
+// Menus, HUD messages and the pause graphic get drawn into a scratch screen
+// instead of screens[0] when the overlay is on. Whatever differs from the last
+// frame's overlay gets handed off and uploaded the same way the screen does,
+// so an overlay that sits still costs a compare instead of an upload, and the
+// screen underneath doesn't have to be redrawn to erase it.
+static byte *overlayscratch;
+static byte *overlayscreen;
+static byte *overlaysavedscreen;
+static int overlaysavedleft[DIRTYBANDS];
+static int overlaysavedright[DIRTYBANDS];
+static int overlaymarkedleft[DIRTYBANDS];
+static int overlaymarkedright[DIRTYBANDS];
+static int overlaydrawnleft[DIRTYBANDS];
+static int overlaydrawnright[DIRTYBANDS];
+static int overlaychangedleft[DIRTYBANDS];
+static int overlaychangedright[DIRTYBANDS];
+static int overlaydrawing = 0;
+static byte *handoffoverlay[NUM_HANDOFF];
+static int handoffoverlaypendingleft[NUM_HANDOFF][DIRTYBANDS];
+static int handoffoverlaypendingright[NUM_HANDOFF][DIRTYBANDS];
+static int handoffoverlaydirtyleft[DIRTYBANDS];
+static int handoffoverlaydirtyright[DIRTYBANDS];
+static int overlay_changes = 0;
+static int overlay_us = 0;
+
+// Frame cost with and without the menu up, to see what it's costing.
+static int overlay_menu_us = 0;
+static int overlay_nomenu_us = 0;
+
+// Internal resolutions selectable in the test menu, must match main.c.
+#define RENDER_RESOLUTION_AUTO 3
+static int render_resolutions[][2] = {
+    { SCREENWIDTH, SCREENHEIGHT },
+    { (SCREENWIDTH * 3) / 2, (SCREENHEIGHT * 3) / 2 },
+    { MAXRENDERWIDTH, MAXRENDERHEIGHT },
+};
+
+// Frame rates selectable in the test menu, must match main.c.
+#define FRAME_RATE_UNCAPPED 1
+
+// HUD layers selectable in the test menu, must match main.c.
+#define HUD_LAYER_HARDWARE 1
+
+// Wall drawing modes selectable in the test menu, must match main.c.
+#define WALL_DRAWING_DEFERRED 1
+
+// Steps the resolution governor moves between when the test menu is set to
+// auto, cheapest first. The view size is left alone since that's the player's.
+typedef struct
+{
+    char *name;
+    int width;
+    int height;
+    int lowdetail;
+} render_step_t;
+
+static render_step_t render_steps[] = {
+    { "320x200 Low", SCREENWIDTH, SCREENHEIGHT, 1 },
+    { "320x200", SCREENWIDTH, SCREENHEIGHT, 0 },
+    { "480x300", (SCREENWIDTH * 3) / 2, (SCREENHEIGHT * 3) / 2, 0 },
+    { "640x400", MAXRENDERWIDTH, MAXRENDERHEIGHT, 0 },
+};
+
+#define NUM_RENDER_STEPS (sizeof(render_steps) / sizeof(render_steps[0]))
+
+// Aim for every frame's work to fit inside a tic (or a video frame when drawing
+// uncapped), dropping a step when we don't and only going back up when the next
+// step's estimated cost leaves plenty of room, so we don't flicker between two.
+#define GOVERNOR_TARGET_CAPPED_US (1000000 / TICRATE)
+#define GOVERNOR_TARGET_UNCAPPED_US (1000000 / 60)
+#define GOVERNOR_DOWN_PERCENT 95
+#define GOVERNOR_UP_PERCENT 75
+#define GOVERNOR_DOWN_FRAMES 8
+#define GOVERNOR_UP_FRAMES 70
+#define GOVERNOR_SETTLE_FRAMES 35
+
+static int governor_enabled = 0;
+static int governor_target_us = GOVERNOR_TARGET_CAPPED_US;
+static int governor_step = 1;
+static int governor_busy_us = 0;
+static int governor_render_us = 0;
+static int governor_over = 0;
+static int governor_under = 0;
+static int governor_settle = 0;
+static int governor_changes = 0;
+static int governor_last_frames = 0;
+static uint64_t governor_last_finish = 0;
+
+// Every PLAYPAL palette at every gamma level, already in palette entry form
+// for both banks, so that damage and pickup flashes are just a copy. There are
+// far too many for the hardware banks to hold them all at once. The main thread
+// only picks one, and the video thread loads it alongside the frame it goes with.
+// Palettes that aren't in PLAYPAL are built into one of a few custom slots, never
+// one that a queued frame or the video thread might still be reading.
+#define NUM_PALETTES 14
+#define NUM_GAMMA 5
+#define PALETTE_CUSTOM (NUM_PALETTES * NUM_GAMMA)
+#define NUM_CUSTOM_PALETTES (NUM_HANDOFF + 4)
+static uint32_t (*palette_cache)[2][256] = NULL;
+static int playpal_lump = -1;
+static volatile int palette_wanted = 0;
+static volatile int palette_loaded = -1;
+static volatile int palette_loading = -1;
+static int palette_keyed = 0;
+static int handoffpalette[NUM_HANDOFF];
+
+// Palette statistics, shown in the debug overlay.
+static int palette_changes = 0;
+static int palette_us = 0;
+static int palette_load_us = 0;
+
+// What changed since the video thread last picked up a frame.
+static int handoffdirtyleft[DIRTYBANDS];
+static int handoffdirtyright[DIRTYBANDS];
+
+// Timing breakdown, shown in the debug overlay.
+static int upload_bytes = 0;
+static int upload_us = 0;
+static int handoff_us = 0;
+static int handoff_dropped = 0;
+
+// When each frame passed through each stage, from the controls it was built
+// from to the vblank it went up on, so we know how long a press takes to show.
+typedef struct
+{
+    // When the video thread polled the controls this frame reacted to.
+    uint64_t input;
+
+    // When the main thread picked those controls up.
+    uint64_t tic;
+
+    // When the main thread finished drawing it.
+    uint64_t rendered;
+
+    // When the video thread finished putting it in VRAM.
+    uint64_t uploaded;
+
+    // The vblank it was flipped onto the screen at.
+    uint64_t scanout;
+} frame_times_t;
+
+static frame_times_t handofftimes[NUM_HANDOFF];
+
+// The display always runs at 60Hz, in both 15kHz and 31kHz modes. A frame
+// handed off before a vblank gets picked up there and shown on the next one,
+// so when drawing uncapped the main thread sleeps until it can just finish the
+// next frame before the vblank after the one the current frame gets picked
+// up on. That way it reacts to the newest controls instead of sitting on old
+// ones waiting for the video thread.
+#define VBLANK_US (1000000 / 60)
+#define PACING_MARGIN_US 2000
+
+static volatile uint64_t last_vblank = 0;
+static uint64_t pacing_frame_start = 0;
+static int pacing_frame_us = 0;
+static int pacing_sleep_us = 0;
+static int pacing_late = 0;
+
+// Motion to photon, averaged over frames, along with the worst recently.
+static int latency_us = 0;
+static int latency_peak_us = 0;
+static int latency_input_us = 0;
+static int latency_render_us = 0;
+static int latency_upload_us = 0;
+static int latency_scanout_us = 0;
+
+// Defined in main.c, for timing.
+uint64_t _get_time();
+
+// Defined in main.c, for the test menu render resolution.
+int naomi_get_render_resolution();
+
+// Defined in main.c, for the test menu frame rate.
+int naomi_get_frame_rate();
+
+// Defined in main.c, for the test menu HUD layer.
+int naomi_get_hud_layer();
+
+// Defined in main.c, for the test menu wall drawing mode.
+int naomi_get_wall_drawing();
+
 // Shared with main.c
 extern int controls_needed;
 extern int controls_available;
+extern uint64_t controls_poll_time;
+extern uint64_t controls_input_time;
+extern uint64_t controls_tic_time;
 
 // Shared with i_naomi_music.h
 extern float percent_empty;
+extern float music_cpu_share;
 extern int m_volume;
+char *music_tier_name();
+
+// Shared with i_naomi_sound.c
+extern int sfx_voices_used;
+extern int sfx_voices_peak;
+extern int sfx_voices_stolen;
+extern int sfx_voices_dropped;
+extern int sfx_hw_voices;
+extern int sfx_updates_per_tic;
+extern int sfx_writes_per_tic;
+extern int sfx_aica_bytes;
+extern int sfx_aica_samples;
+extern int sfx_aica_evictions;
+
+// Shared with s_sound.c
+extern int s_update_us;
+extern int s_update_computed;
+extern int s_update_submitted;
+
+// Shared with r_main.c
+extern int r_render_us;
+extern int r_render_frames;
+extern int r_angle_calls;
+extern int r_angle_cached;
+extern int r_storewall_frame_us;
+extern int r_deferwalls_frame_us;
+extern int r_masked_frame_us;
+extern int r_masked_sprites;
+extern int r_masked_drawsegs;
+extern int r_sky_frame_us;
+extern int r_sky_frame_columns;
+extern int r_tagchanges_frame;
+
+// Shared with am_map.c
+extern int am_drawer_us;
+extern int am_cached_lines;
+extern int am_reclips;
+
+// Shared with d_net.c
+extern int net_wait_us;
+
+// Shared with f_wipe.c
+extern int wipe_us;
+extern int wipe_work_us;
 
 // Shared with main.c
 extern mutex_t control_mutex;
@@ -52,9 +333,308 @@ void _enableAnyVideoUpdates()
     started = 1;
 }
 
+static void _merge_dirty(int *left, int *right, int *srcleft, int *srcright)
+{
+    for (int band = 0; band < DIRTYBANDS; band++)
+    {
+        if (srcleft[band] == srcright[band])
+        {
+            continue;
+        }
+
+        if (left[band] == right[band])
+        {
+            left[band] = srcleft[band];
+            right[band] = srcright[band];
+        }
+        else
+        {
+            if (srcleft[band] < left[band]) { left[band] = srcleft[band]; }
+            if (srcright[band] > right[band]) { right[band] = srcright[band]; }
+        }
+    }
+}
+
+static void _mark_all(int *left, int *right)
+{
+    for (int band = 0; band < DIRTYBANDS; band++)
+    {
+        left[band] = 0;
+        right[band] = SCREENWIDTH;
+    }
+}
+
+static void _mark_none(int *left, int *right)
+{
+    for (int band = 0; band < DIRTYBANDS; band++)
+    {
+        left[band] = right[band] = 0;
+    }
+}
+
+// Pushes whatever the layer's back texture is missing from a handed off frame,
+// and returns how many bytes that took.
+static int _upload_layer(screen_layer_t *layer, byte *screen, int *dirtyleft, int *dirtyright)
+{
+    int tex = 1 - layer->which;
+    int bytes = 0;
+    int (*pendingleft)[DIRTYBANDS] = layer->pendingleft;
+    int (*pendingright)[DIRTYBANDS] = layer->pendingright;
+
+    // Both textures need to hear about what changed this frame.
+    _merge_dirty(pendingleft[0], pendingright[0], dirtyleft, dirtyright);
+    _merge_dirty(pendingleft[1], pendingright[1], dirtyleft, dirtyright);
+
+    // Form the LUT texture, only pushing the parts this texture is missing.
+    for (int band = 0; band < DIRTYBANDS; band++)
+    {
+        if (pendingleft[tex][band] == pendingright[tex][band])
+        {
+            continue;
+        }
+
+        // Keep uploads on 8 pixel boundaries to match the texture's tiling.
+        int left = pendingleft[tex][band] & ~7;
+        int right = (pendingright[tex][band] + 7) & ~7;
+        int top = band * DIRTYBANDHEIGHT;
+        int height = DIRTYBANDHEIGHT;
+
+        if (right > SCREENWIDTH) { right = SCREENWIDTH; }
+        if (top + height > SCREENHEIGHT) { height = SCREENHEIGHT - top; }
+
+        // Gather up runs of full-width bands so they go in one call.
+        if (left == 0 && right == SCREENWIDTH)
+        {
+            while (
+                band + 1 < DIRTYBANDS &&
+                pendingleft[tex][band + 1] < 8 &&
+                pendingright[tex][band + 1] > (SCREENWIDTH - 8)
+            )
+            {
+                pendingleft[tex][band] = pendingright[tex][band] = 0;
+                band++;
+                height = (band * DIRTYBANDHEIGHT) + DIRTYBANDHEIGHT - top;
+                if (top + height > SCREENHEIGHT) { height = SCREENHEIGHT - top; }
+            }
+
+            ta_texture_load_sprite(
+                layer->tex[tex]->vram_location,
+                layer->tex[tex]->width,
+                8,
+                0,
+                top,
+                SCREENWIDTH,
+                height,
+                screen + (top * SCREENWIDTH)
+            );
+        }
+        else
+        {
+            // Partial rows aren't contiguous, so pack them first.
+            int width = right - left;
+            for (int y = 0; y < height; y++)
+            {
+                memcpy(uploadbuf + (y * width), screen + ((top + y) * SCREENWIDTH) + left, width);
+            }
+
+            ta_texture_load_sprite(
+                layer->tex[tex]->vram_location,
+                layer->tex[tex]->width,
+                8,
+                left,
+                top,
+                width,
+                height,
+                uploadbuf
+            );
+        }
+
+        bytes += (right - left) * height;
+        pendingleft[tex][band] = pendingright[tex][band] = 0;
+    }
+
+    layer->which = tex;
+    return bytes;
+}
+
+static void _set_render_step(int step)
+{
+    governor_step = step;
+    R_SetRenderResolution(render_steps[step].width, render_steps[step].height);
+    R_ForceLowDetail(render_steps[step].lowdetail);
+
+    // Old measurements don't mean anything at the new step.
+    governor_over = 0;
+    governor_under = 0;
+    governor_settle = GOVERNOR_SETTLE_FRAMES;
+}
+
+static int _render_step_cost(int step)
+{
+    return (render_steps[step].width * render_steps[step].height) >> render_steps[step].lowdetail;
+}
+
+// Called once per frame with how long the main thread spent working on it.
+static void _govern_resolution(int busy_us)
+{
+    // Smooth things out so a single slow frame doesn't cause a change.
+    governor_busy_us += (busy_us - governor_busy_us) / 8;
+    governor_render_us += (r_render_us - governor_render_us) / 8;
+
+    if (governor_settle > 0)
+    {
+        governor_settle--;
+        return;
+    }
+
+    if (governor_busy_us > (governor_target_us * GOVERNOR_DOWN_PERCENT) / 100)
+    {
+        governor_under = 0;
+        if (++governor_over >= GOVERNOR_DOWN_FRAMES && governor_step > 0)
+        {
+#ifdef NAOMI_DEBUG
+            printf("Governor: busy %dus, dropping to %s\n", governor_busy_us, render_steps[governor_step - 1].name);
+#endif
+            governor_changes++;
+            _set_render_step(governor_step - 1);
+        }
+        return;
+    }
+
+    governor_over = 0;
+    if (governor_step + 1 >= NUM_RENDER_STEPS)
+    {
+        return;
+    }
+
+    // Only the view scales with resolution, the rest of the frame stays the same.
+    int next_render_us = (int)(((int64_t)governor_render_us * _render_step_cost(governor_step + 1)) / _render_step_cost(governor_step));
+    int next_busy_us = governor_busy_us - governor_render_us + next_render_us;
+    if (next_busy_us < (governor_target_us * GOVERNOR_UP_PERCENT) / 100)
+    {
+        if (++governor_under >= GOVERNOR_UP_FRAMES)
+        {
+#ifdef NAOMI_DEBUG
+            printf("Governor: busy %dus, estimated %dus, raising to %s\n", governor_busy_us, next_busy_us, render_steps[governor_step + 1].name);
+#endif
+            governor_changes++;
+            _set_render_step(governor_step + 1);
+        }
+    }
+    else
+    {
+        governor_under = 0;
+    }
+}
+
+static void _build_palette(uint32_t (*entries)[256], byte *palette, int gamma)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        byte c = gammatable[gamma][*palette++];
+        color_t color;
+        color.r = (c<<8) + c;
+        c = gammatable[gamma][*palette++];
+        color.g = (c<<8) + c;
+        c = gammatable[gamma][*palette++];
+        color.b = (c<<8) + c;
+        color.a = 255;
+
+        entries[0][i] = ta_palette_entry(color);
+
+        // The screen drawn over a view and the overlay need to be able to see through.
+        if (i == VIEWKEYCOLOR)
+        {
+            color.a = 0;
+        }
+        entries[1][i] = ta_palette_entry(color);
+    }
+}
+
+static void _load_palette(int slot, int keyed)
+{
+    uint64_t start = _get_time();
+
+    // The view uses the first bank and the screen the second, which is only
+    // keyed when there's a view under it to show. The overlay is always keyed.
+    memcpy(ta_palette_bank(TA_PALETTE_CLUT8, 0), palette_cache[slot][0], sizeof(palette_cache[slot][0]));
+    memcpy(ta_palette_bank(TA_PALETTE_CLUT8, 1), palette_cache[slot][keyed ? 1 : 0], sizeof(palette_cache[slot][0]));
+    memcpy(ta_palette_bank(TA_PALETTE_CLUT8, 2), palette_cache[slot][1], sizeof(palette_cache[slot][1]));
+    palette_loaded = slot;
+    palette_keyed = keyed;
+
+    palette_load_us = (int)(_get_time() - start);
+}
+
+static void _note_vblank(uint64_t now)
+{
+    ATOMIC({
+        last_vblank = now;
+    });
+}
+
+static void _measure_latency(frame_times_t *times)
+{
+    // A frame without any controls polled yet doesn't say anything.
+    if (times->input == 0)
+    {
+        return;
+    }
+
+    int total = (int)(times->scanout - times->input);
+    latency_us += (total - latency_us) / 8;
+    latency_input_us += ((int)(times->tic - times->input) - latency_input_us) / 8;
+    latency_render_us += ((int)(times->rendered - times->tic) - latency_render_us) / 8;
+    latency_upload_us += ((int)(times->uploaded - times->rendered) - latency_upload_us) / 8;
+    latency_scanout_us += ((int)(times->scanout - times->uploaded) - latency_scanout_us) / 8;
+
+    // Let the peak decay so a single hitch doesn't stick around forever.
+    latency_peak_us -= latency_peak_us / 64;
+    if (total > latency_peak_us)
+    {
+        latency_peak_us = total;
+    }
+
+    // Anything handed off gets picked up on the next vblank and shown on the
+    // one after, so taking longer than that means it missed its vblank.
+    if (times->scanout - times->rendered > (2 * VBLANK_US) + PACING_MARGIN_US)
+    {
+        pacing_late++;
+    }
+}
+
+static int _pacing_delay(uint64_t now)
+{
+    uint64_t vblank;
+    ATOMIC({
+        vblank = last_vblank;
+    });
+    if (vblank == 0)
+    {
+        return 0;
+    }
+
+    // The frame we just handed off gets picked up on the next vblank, so the
+    // next frame needs to be handed off before the one after that.
+    uint64_t pickup = vblank + VBLANK_US;
+    while (pickup <= now)
+    {
+        pickup += VBLANK_US;
+    }
+
+    int64_t wake = (int64_t)(pickup + VBLANK_US) - pacing_frame_us - PACING_MARGIN_US;
+    return wake > (int64_t)now ? (int)(wake - (int64_t)now) : 0;
+}
+
 void * video(void * param)
 {
-    int last_drawn_frame = -1;
+    int framedirtyleft[DIRTYBANDS];
+    int framedirtyright[DIRTYBANDS];
+    view_layer_t view;
+    int palette;
+    frame_times_t times;
+    int frameoverlayleft[DIRTYBANDS];
+    int frameoverlayright[DIRTYBANDS];
 
 #ifdef NAOMI_DEBUG
     double video_thread_fps = 0.0;
@@ -73,15 +653,86 @@ void * video(void * param)
         int fps = profile_start();
 #endif
 
+        // Grab the newest finished frame, if there is one.
+        int frame = -1;
+        if (started == 2)
+        {
+            ATOMIC({
+                frame = handoff_ready;
+                if (frame >= 0)
+                {
+                    handoff_ready = -1;
+                    handoff_uploading = frame;
+                    memcpy(framedirtyleft, handoffdirtyleft, sizeof(framedirtyleft));
+                    memcpy(framedirtyright, handoffdirtyright, sizeof(framedirtyright));
+                    _mark_none(handoffdirtyleft, handoffdirtyright);
+                    memcpy(frameoverlayleft, handoffoverlaydirtyleft, sizeof(frameoverlayleft));
+                    memcpy(frameoverlayright, handoffoverlaydirtyright, sizeof(frameoverlayright));
+                    _mark_none(handoffoverlaydirtyleft, handoffoverlaydirtyright);
+                    view = handoffview[frame];
+                    palette = handoffpalette[frame];
+                    palette_loading = palette;
+                    times = handofftimes[frame];
+                }
+            });
+        }
+
         // Only draw to the texture if we got an update.
-        if (started == 2 && last_drawn_frame != doom_updates)
+        if (frame >= 0)
         {
-            // Remember that we did this.
-            last_drawn_frame = doom_updates;
+            // Copy it to VRAM while the main thread works on the next one.
+            uint64_t upload_start = _get_time();
+            upload_bytes = _upload_layer(&screenlayer, handoff[frame], framedirtyleft, framedirtyright);
+            if (hudoverlay)
+            {
+                upload_bytes += _upload_layer(&overlaylayer, handoffoverlay[frame], frameoverlayleft, frameoverlayright);
+            }
+            if (view.drawn)
+            {
+                // The whole view changes every frame, so there's no point tracking it.
+                whichviewtex = 1 - whichviewtex;
+                ta_texture_load_sprite(
+                    viewtex[whichviewtex]->vram_location,
+                    viewtex[whichviewtex]->width,
+                    8,
+                    0,
+                    0,
+                    view.renderwidth,
+                    view.renderheight,
+                    handoffviewbuf[frame]
+                );
+            }
+            times.uploaded = _get_time();
+            upload_us = (int)(times.uploaded - upload_start);
+            handoff_uploading = -1;
+
+            // Switch palettes right as the frame that wanted it goes up. Custom
+            // slots are never rebuilt while loaded, so the slot says it all.
+            if (palette != palette_loaded || view.drawn != palette_keyed)
+            {
+                _load_palette(palette, view.drawn);
+            }
+            palette_loading = -1;
 
             // Now, request to draw the texture, making sure to scale it properly
             ta_commit_begin();
-            sprite_draw_scaled(0, yoff, xscale, yscale, outtex[whichtex]);
+            if (view.drawn)
+            {
+                // The view goes underneath, showing through the key color in the window.
+                sprite_draw_scaled(
+                    (int)((float)view.x * xscale),
+                    yoff + (int)((float)view.y * yscale),
+                    (xscale * (float)view.width) / (float)view.renderwidth,
+                    (yscale * (float)view.height) / (float)view.renderheight,
+                    viewtex[whichviewtex]
+                );
+            }
+            sprite_draw_scaled(0, yoff, xscale, yscale, screenlayer.tex[screenlayer.which]);
+            if (hudoverlay)
+            {
+                // Menus and messages go over everything, keyed on their own bank.
+                sprite_draw_scaled(0, yoff, xscale, yscale, overlaylayer.tex[overlaylayer.which]);
+            }
             ta_commit_end();
 
             // Now, ask the TA to scale it for us
@@ -89,19 +740,61 @@ void * video(void * param)
 
 #ifdef NAOMI_DEBUG
             video_draw_debug_text(debugxoff, 20, rgb(200, 200, 20), "Video FPS: %.01f, %dx%d", video_thread_fps, video_width(), video_height());
-            video_draw_debug_text(debugxoff, 30, rgb(200, 200, 20), "DOOM FPS: %.01f, %dx%d", doom_fps, SCREENWIDTH, SCREENHEIGHT);
+            video_draw_debug_text(debugxoff, 30, rgb(200, 200, 20), "DOOM FPS: %.01f, %dx%d, %d bytes uploaded", doom_fps, SCREENWIDTH, SCREENHEIGHT, upload_bytes);
             video_draw_debug_text(debugxoff, 40, rgb(200, 200, 20), "Audio Buf Empty: %.01f%%", percent_empty * 100.0);
             video_draw_debug_text(debugxoff, 50, rgb(200, 200, 20), "Music Volume: %d/15", m_volume);
-            video_draw_debug_text(debugxoff, 60, rgb(200, 200, 20), "IRQs: %lu", sched.interruptions);
+            video_draw_debug_text(debugxoff, 60, rgb(200, 200, 20), "Music Tier: %s, CPU %.01f%%", music_tier_name(), music_cpu_share * 100.0);
+            video_draw_debug_text(debugxoff, 70, rgb(200, 200, 20), "SFX Voices: %d (peak %d), stolen %d, dropped %d", sfx_voices_used, sfx_voices_peak, sfx_voices_stolen, sfx_voices_dropped);
+            video_draw_debug_text(debugxoff, 80, rgb(200, 200, 20), "SFX HW Voices: %d, updates %d, writes %d", sfx_hw_voices, sfx_updates_per_tic, sfx_writes_per_tic);
+            video_draw_debug_text(debugxoff, 90, rgb(200, 200, 20), "SFX AICA: %d bytes, %d samples, %d evictions", sfx_aica_bytes, sfx_aica_samples, sfx_aica_evictions);
+            video_draw_debug_text(debugxoff, 100, rgb(200, 200, 20), "SFX Positional: %dus, %d computed, %d submitted", s_update_us, s_update_computed, s_update_submitted);
+            video_draw_debug_text(debugxoff, 110, rgb(200, 200, 20), "Frame Handoff: %dus main, %dus upload, %d dropped", handoff_us, upload_us, handoff_dropped);
+            video_draw_debug_text(debugxoff, 120, rgb(200, 200, 20), "Render: %dx%d, %dus, %dus walls, %d angles, %d cached", renderwidth, renderheight, r_render_us, r_storewall_frame_us, r_angle_calls, r_angle_cached);
+            video_draw_debug_text(
+                debugxoff, 130, rgb(200, 200, 20), "Governor: %s, %s, busy %dus/%dus, %d changes",
+                governor_enabled ? "On" : "Off", render_steps[governor_step].name,
+                governor_busy_us, governor_target_us, governor_changes
+            );
+            video_draw_debug_text(debugxoff, 140, rgb(200, 200, 20), "Palette: %d changes, %dus main, %dus load", palette_changes, palette_us, palette_load_us);
+            video_draw_debug_text(debugxoff, 150, rgb(200, 200, 20), "IRQs: %lu", sched.interruptions);
+            video_draw_debug_text(debugxoff, 160, rgb(200, 200, 20), "Latency: %dus, peak %dus, %d late", latency_us, latency_peak_us, pacing_late);
+            video_draw_debug_text(
+                debugxoff, 170, rgb(200, 200, 20), "Latency Stages: %dus input, %dus render, %dus upload, %dus scanout",
+                latency_input_us, latency_render_us, latency_upload_us, latency_scanout_us
+            );
+            video_draw_debug_text(debugxoff, 180, rgb(200, 200, 20), "Pacing: %s, %dus frame, %dus slept", uncappedframes ? "Vblank" : "Tics", pacing_frame_us, pacing_sleep_us);
+            video_draw_debug_text(
+                debugxoff, 190, rgb(200, 200, 20), "Overlay: %s, %d changes, %dus, frame %dus menu, %dus no menu",
+                hudoverlay ? "Hardware" : "Software", overlay_changes, overlay_us, overlay_menu_us, overlay_nomenu_us
+            );
+            video_draw_debug_text(
+                debugxoff, 200, rgb(200, 200, 20), "Wipe: %dus, %dus melting, %d%% main thread free",
+                wipe_us, wipe_work_us, wipe_us ? 100 - (int)(((int64_t)wipe_work_us * 100) / wipe_us) : 100
+            );
+            video_draw_debug_text(
+                debugxoff, 210, rgb(200, 200, 20), "Walls: %s, %dus drawing deferred, %dus render",
+                deferwalls ? "Deferred" : "Direct", r_deferwalls_frame_us, r_render_us
+            );
+            video_draw_debug_text(
+                debugxoff, 220, rgb(200, 200, 20), "Masked: %dus, %d sprites, %d drawsegs",
+                r_masked_frame_us, r_masked_sprites, r_masked_drawsegs
+            );
+            video_draw_debug_text(debugxoff, 230, rgb(200, 200, 20), "Sky: %dus, %d columns", r_sky_frame_us, r_sky_frame_columns);
+            video_draw_debug_text(debugxoff, 240, rgb(200, 200, 20), "Zone: %d tag changes, %d flats pinned", r_tagchanges_frame, r_flats_pinned);
+            video_draw_debug_text(debugxoff, 250, rgb(200, 200, 20), "Automap: %dus, %d lines in window, %d reclips", am_drawer_us, am_cached_lines, am_reclips);
             video_updates ++;
 #endif
 
             // Now, display it on the next vblank
             video_display_on_vblank();
+            times.scanout = _get_time();
+            _note_vblank(times.scanout);
+            _measure_latency(&times);
         }
         else
         {
             thread_wait_vblank_in();
+            _note_vblank(_get_time());
         }
 
         // Now, poll for buttons where it is safe.
@@ -111,6 +804,7 @@ void * video(void * param)
             controls_needed = 0;
             controls_available = 1;
             maple_poll_buttons();
+            controls_poll_time = _get_time();
         }
         mutex_unlock(&control_mutex);
 
@@ -142,18 +836,109 @@ void * video(void * param)
 void I_InitGraphics (void)
 {
     // Create a texture that we can use to render to to use hardware stretching.
+    // This uses the second palette bank, where the view key color is see-through
+    // whenever a view is drawn under it.
     int uvsize = ta_round_uvsize(SCREENWIDTH > SCREENHEIGHT ? SCREENWIDTH : SCREENHEIGHT);
-    outtex[0] = ta_texture_desc_malloc_paletted(uvsize, NULL, TA_PALETTE_CLUT8, 0);
-    outtex[1] = ta_texture_desc_malloc_paletted(uvsize, NULL, TA_PALETTE_CLUT8, 0);
-    whichtex = 0;
+    screenlayer.tex[0] = ta_texture_desc_malloc_paletted(uvsize, NULL, TA_PALETTE_CLUT8, 1);
+    screenlayer.tex[1] = ta_texture_desc_malloc_paletted(uvsize, NULL, TA_PALETTE_CLUT8, 1);
+    screenlayer.which = 0;
+
+    // The overlay, if we're drawing one, gets the third bank, always keyed so
+    // that only the menus and messages on it show.
+    hudoverlay = naomi_get_hud_layer() == HUD_LAYER_HARDWARE;
+    if (hudoverlay)
+    {
+        overlaylayer.tex[0] = ta_texture_desc_malloc_paletted(uvsize, NULL, TA_PALETTE_CLUT8, 2);
+        overlaylayer.tex[1] = ta_texture_desc_malloc_paletted(uvsize, NULL, TA_PALETTE_CLUT8, 2);
+        overlaylayer.which = 0;
+    }
+
+    // And the ones a view drawn above screen resolution goes in, which are
+    // only ever displayed after being uploaded to.
+    int viewuvsize = ta_round_uvsize(MAXRENDERWIDTH > MAXRENDERHEIGHT ? MAXRENDERWIDTH : MAXRENDERHEIGHT);
+    viewtex[0] = ta_texture_desc_malloc_paletted(viewuvsize, NULL, TA_PALETTE_CLUT8, 0);
+    viewtex[1] = ta_texture_desc_malloc_paletted(viewuvsize, NULL, TA_PALETTE_CLUT8, 0);
+    whichviewtex = 0;
+
+    // Draw between tics only if the operator asked for it, since it costs
+    // more than simply repeating a frame.
+    uncappedframes = naomi_get_frame_rate() == FRAME_RATE_UNCAPPED;
+    governor_target_us = uncappedframes ? GOVERNOR_TARGET_UNCAPPED_US : GOVERNOR_TARGET_CAPPED_US;
+
+    // Draw walls a texture at a time after the BSP walk if asked to, so the
+    // two can be compared on the same cabinet.
+    deferwalls = naomi_get_wall_drawing() == WALL_DRAWING_DEFERRED;
+
+    // Draw the 3D view at whatever resolution the operator picked, or let the
+    // governor work it out starting from the original resolution.
+    int resolution = naomi_get_render_resolution();
+    if (resolution == RENDER_RESOLUTION_AUTO)
+    {
+        governor_enabled = 1;
+        _set_render_step(1);
+    }
+    else
+    {
+        governor_enabled = 0;
+        R_SetRenderResolution(render_resolutions[resolution][0], render_resolutions[resolution][1]);
+    }
 
     // Wipe the textures so we don't have garbage on them.
     void *tmp = malloc(uvsize * uvsize);
     memset(tmp, 0, uvsize * uvsize);
-    ta_texture_load(outtex[0]->vram_location, outtex[0]->width, 8, tmp);
-    ta_texture_load(outtex[1]->vram_location, outtex[1]->width, 8, tmp);
+    ta_texture_load(screenlayer.tex[0]->vram_location, screenlayer.tex[0]->width, 8, tmp);
+    ta_texture_load(screenlayer.tex[1]->vram_location, screenlayer.tex[1]->width, 8, tmp);
+    if (hudoverlay)
+    {
+        // An empty overlay is see-through everywhere.
+        memset(tmp, VIEWKEYCOLOR, uvsize * uvsize);
+        ta_texture_load(overlaylayer.tex[0]->vram_location, overlaylayer.tex[0]->width, 8, tmp);
+        ta_texture_load(overlaylayer.tex[1]->vram_location, overlaylayer.tex[1]->width, 8, tmp);
+    }
     free(tmp);
 
+    // Neither texture has anything from the screen yet.
+    _mark_all(screenlayer.pendingleft[0], screenlayer.pendingright[0]);
+    _mark_all(screenlayer.pendingleft[1], screenlayer.pendingright[1]);
+    V_ClearDirty();
+
+    // Whereas the overlay textures already match an empty overlay.
+    if (hudoverlay)
+    {
+        overlayscratch = malloc(SCREENWIDTH * SCREENHEIGHT);
+        overlayscreen = malloc(SCREENWIDTH * SCREENHEIGHT);
+        memset(overlayscratch, VIEWKEYCOLOR, SCREENWIDTH * SCREENHEIGHT);
+        memset(overlayscreen, VIEWKEYCOLOR, SCREENWIDTH * SCREENHEIGHT);
+        _mark_none(overlaylayer.pendingleft[0], overlaylayer.pendingright[0]);
+        _mark_none(overlaylayer.pendingleft[1], overlaylayer.pendingright[1]);
+        _mark_none(overlaymarkedleft, overlaymarkedright);
+        _mark_none(overlaydrawnleft, overlaydrawnright);
+        _mark_none(overlaychangedleft, overlaychangedright);
+    }
+
+    // Scratch space for packing partial rows before uploading them.
+    uploadbuf = malloc(SCREENWIDTH * DIRTYBANDHEIGHT);
+
+    // Set up the buffers we hand finished frames to the video thread in.
+    for (int i = 0; i < NUM_HANDOFF; i++)
+    {
+        handoff[i] = malloc(SCREENWIDTH * SCREENHEIGHT);
+        _mark_all(handoffpendingleft[i], handoffpendingright[i]);
+        handoffview[i].drawn = 0;
+        handoffpalette[i] = palette_wanted;
+
+        if (hudoverlay)
+        {
+            handoffoverlay[i] = malloc(SCREENWIDTH * SCREENHEIGHT);
+            memset(handoffoverlay[i], VIEWKEYCOLOR, SCREENWIDTH * SCREENHEIGHT);
+            _mark_none(handoffoverlaypendingleft[i], handoffoverlaypendingright[i]);
+        }
+    }
+    _mark_none(handoffdirtyleft, handoffdirtyright);
+    _mark_none(handoffoverlaydirtyleft, handoffoverlaydirtyright);
+    handoff_ready = -1;
+    handoff_uploading = -1;
+
     // Calculate the scaling factors and y offset. This is based off
     // of the assumption that doom wants to be stretched to a 4:3 resolution.
     if (video_is_vertical())
@@ -204,25 +989,74 @@ void I_WaitVBL (int count)
     }
 }
 
+// Finds a custom palette slot that nothing is using or about to use.
+static int _free_custom_palette()
+{
+    int slot = -1;
+
+    ATOMIC({
+        for (int i = PALETTE_CUSTOM; i < PALETTE_CUSTOM + NUM_CUSTOM_PALETTES && slot < 0; i++)
+        {
+            int used = (i == palette_wanted || i == palette_loading || i == palette_loaded);
+            for (int j = 0; j < NUM_HANDOFF; j++)
+            {
+                used |= (handoffpalette[j] == i);
+            }
+            if (!used)
+            {
+                slot = i;
+            }
+        }
+    });
+
+    return slot;
+}
+
 // Takes full 8 bit values.
 void I_SetPalette (byte* palette)
 {
-    // set the X colormap entries
-    uint32_t *bank = ta_palette_bank(TA_PALETTE_CLUT8, 0);
+    uint64_t start = _get_time();
 
-    for (int i = 0; i < 256; i++)
+    // Work out every palette ahead of time, the first time we're asked for one.
+    if (!palette_cache)
     {
-        byte c = gammatable[usegamma][*palette++];
-        color_t color;
-        color.r = (c<<8) + c;
-        c = gammatable[usegamma][*palette++];
-        color.g = (c<<8) + c;
-        c = gammatable[usegamma][*palette++];
-        color.b = (c<<8) + c;
-        color.a = 255;
+        palette_cache = malloc(sizeof(palette_cache[0]) * (PALETTE_CUSTOM + NUM_CUSTOM_PALETTES));
+        playpal_lump = W_GetNumForName("PLAYPAL");
+
+        byte *playpal = W_CacheLumpNum(playpal_lump, PU_CACHE);
+        for (int i = 0; i < NUM_PALETTES; i++)
+        {
+            for (int gamma = 0; gamma < NUM_GAMMA; gamma++)
+            {
+                _build_palette(palette_cache[(i * NUM_GAMMA) + gamma], playpal + (i * 768), gamma);
+            }
+        }
+    }
 
-        bank[i] = ta_palette_entry(color);
+    // Callers hand us a palette straight out of PLAYPAL, so we can tell which
+    // one it is from where it is. Anything else gets built on the spot.
+    // The custom slot is only published once it's completely built.
+    int slot;
+    byte *playpal = W_CacheLumpNum(playpal_lump, PU_CACHE);
+    if (palette >= playpal && palette < playpal + (NUM_PALETTES * 768) && ((palette - playpal) % 768) == 0)
+    {
+        slot = (((palette - playpal) / 768) * NUM_GAMMA) + usegamma;
+    }
+    else
+    {
+        slot = _free_custom_palette();
+        _build_palette(palette_cache[slot], palette, usegamma);
     }
+
+    if (video_thread == 0)
+    {
+        // Nothing is displaying frames yet, so nothing to line up with.
+        _load_palette(slot, 0);
+    }
+    palette_wanted = slot;
+
+    palette_changes++;
+    palette_us = (int)(_get_time() - start);
 }
 
 void I_UpdateNoBlit (void)
@@ -230,46 +1064,414 @@ void I_UpdateNoBlit (void)
     // Empty
 }
 
+void I_BeginOverlay (void)
+{
+    if (!hudoverlay || overlaydrawing)
+    {
+        return;
+    }
+
+    // Point drawing at the overlay, putting aside what's been marked on the
+    // screen so far so we can tell what got drawn on the overlay.
+    overlaysavedscreen = screens[0];
+    memcpy(overlaysavedleft, dirtyleft, sizeof(overlaysavedleft));
+    memcpy(overlaysavedright, dirtyright, sizeof(overlaysavedright));
+    V_ClearDirty();
+    screens[0] = overlayscratch;
+    overlaydrawing = 1;
+}
+
+void I_EndOverlay (void)
+{
+    if (!overlaydrawing)
+    {
+        return;
+    }
+
+    _merge_dirty(overlaymarkedleft, overlaymarkedright, dirtyleft, dirtyright);
+    memcpy(dirtyleft, overlaysavedleft, sizeof(overlaysavedleft));
+    memcpy(dirtyright, overlaysavedright, sizeof(overlaysavedright));
+    screens[0] = overlaysavedscreen;
+    overlaydrawing = 0;
+}
+
+// Copies the marked parts of one screen sized buffer to another.
+static void _copy_bands(byte *dest, byte *src, int *left, int *right)
+{
+    for (int band = 0; band < DIRTYBANDS; band++)
+    {
+        if (left[band] == right[band])
+        {
+            continue;
+        }
+
+        int top = band * DIRTYBANDHEIGHT;
+        int bottom = top + DIRTYBANDHEIGHT;
+        if (bottom > SCREENHEIGHT) { bottom = SCREENHEIGHT; }
+
+        for (int y = top; y < bottom; y++)
+        {
+            memcpy(dest + (y * SCREENWIDTH) + left[band], src + (y * SCREENWIDTH) + left[band], right[band] - left[band]);
+        }
+    }
+}
+
+// Works out what actually changed on the overlay since the last frame, and
+// empties the scratch overlay for the next one.
+static void _finish_overlay(void)
+{
+    uint64_t start = _get_time();
+    int checkleft[DIRTYBANDS];
+    int checkright[DIRTYBANDS];
+    int changedleft[DIRTYBANDS];
+    int changedright[DIRTYBANDS];
+
+    // Anything drawn last frame or this one could be different.
+    memcpy(checkleft, overlaydrawnleft, sizeof(checkleft));
+    memcpy(checkright, overlaydrawnright, sizeof(checkright));
+    _merge_dirty(checkleft, checkright, overlaymarkedleft, overlaymarkedright);
+    _mark_none(changedleft, changedright);
+
+    for (int band = 0; band < DIRTYBANDS; band++)
+    {
+        if (checkleft[band] == checkright[band])
+        {
+            continue;
+        }
+
+        int left = checkleft[band];
+        int width = checkright[band] - left;
+        int top = band * DIRTYBANDHEIGHT;
+        int bottom = top + DIRTYBANDHEIGHT;
+        if (bottom > SCREENHEIGHT) { bottom = SCREENHEIGHT; }
+
+        for (int y = top; y < bottom; y++)
+        {
+            if (memcmp(overlayscratch + (y * SCREENWIDTH) + left, overlayscreen + (y * SCREENWIDTH) + left, width) != 0)
+            {
+                changedleft[band] = left;
+                changedright[band] = left + width;
+                break;
+            }
+        }
+    }
+
+    // Keep what changed, then clear everything that was drawn.
+    _copy_bands(overlayscreen, overlayscratch, changedleft, changedright);
+    _merge_dirty(overlaychangedleft, overlaychangedright, changedleft, changedright);
+    for (int band = 0; band < DIRTYBANDS; band++)
+    {
+        if (checkleft[band] == checkright[band])
+        {
+            continue;
+        }
+
+        int top = band * DIRTYBANDHEIGHT;
+        int bottom = top + DIRTYBANDHEIGHT;
+        if (bottom > SCREENHEIGHT) { bottom = SCREENHEIGHT; }
+
+        for (int y = top; y < bottom; y++)
+        {
+            memset(overlayscratch + (y * SCREENWIDTH) + checkleft[band], VIEWKEYCOLOR, checkright[band] - checkleft[band]);
+        }
+
+        if (changedleft[band] != changedright[band])
+        {
+            overlay_changes++;
+        }
+    }
+
+    memcpy(overlaydrawnleft, overlaymarkedleft, sizeof(overlaydrawnleft));
+    memcpy(overlaydrawnright, overlaymarkedright, sizeof(overlaydrawnright));
+    _mark_none(overlaymarkedleft, overlaymarkedright);
+    overlay_us = (int)(_get_time() - start);
+}
+
 void I_FinishUpdate (void)
 {
-    // Form the LUT texture.
-    ta_texture_load_sprite(
-        outtex[1 - whichtex]->vram_location,
-        outtex[1 - whichtex]->width,
-        8,
-        0,
-        0,
-        SCREENWIDTH,
-        SCREENHEIGHT,
-        screens[0]
-    );
+    uint64_t start = _get_time();
+    int busy_us = (int)(start - governor_last_finish) - net_wait_us;
+
+    // Only frames with a view in them say anything about how expensive it is.
+    if (governor_enabled && r_render_frames != governor_last_frames && governor_last_finish != 0)
+    {
+        _govern_resolution(busy_us);
+    }
+
+    // Keep track of what having the menu up costs, to compare the overlay against.
+    if (governor_last_finish != 0)
+    {
+        if (menuactive)
+        {
+            overlay_menu_us += (busy_us - overlay_menu_us) / 8;
+        }
+        else
+        {
+            overlay_nomenu_us += (busy_us - overlay_nomenu_us) / 8;
+        }
+    }
+    governor_last_frames = r_render_frames;
+    governor_last_finish = start;
+    net_wait_us = 0;
+
+    // How long this frame took from when we let the main loop go, which is
+    // how early we need to let the next one go to make its vblank.
+    if (pacing_frame_start != 0)
+    {
+        pacing_frame_us += ((int)(start - pacing_frame_start) - pacing_frame_us) / 8;
+    }
+
+    // Drawing uncapped, there's no point getting ahead of the video thread since
+    // the frame would only be replaced before it's shown. Wait for it to take
+    // the last one instead. This only happens when pacing guessed wrong.
+    if (uncappedframes)
+    {
+        while (handoff_ready >= 0)
+        {
+            thread_wait_vblank_out();
+        }
+        net_wait_us += (int)(_get_time() - start);
+    }
+
+    // Every handoff buffer is now missing whatever changed this frame.
+    for (int i = 0; i < NUM_HANDOFF; i++)
+    {
+        _merge_dirty(handoffpendingleft[i], handoffpendingright[i], dirtyleft, dirtyright);
+    }
+
+    // Including on the overlay.
+    if (hudoverlay)
+    {
+        _finish_overlay();
+        for (int i = 0; i < NUM_HANDOFF; i++)
+        {
+            _merge_dirty(handoffoverlaypendingleft[i], handoffoverlaypendingright[i], overlaychangedleft, overlaychangedright);
+        }
+    }
+
+    // Find a buffer that's neither waiting to be uploaded nor being uploaded.
+    int buf = 0;
+    ATOMIC({
+        while (buf == handoff_ready || buf == handoff_uploading) { buf++; }
+    });
+
+    // Bring it up to date with the screen.
+    _copy_bands(handoff[buf], screens[0], handoffpendingleft[buf], handoffpendingright[buf]);
+    _mark_none(handoffpendingleft[buf], handoffpendingright[buf]);
+
+    // And the overlay.
+    if (hudoverlay)
+    {
+        _copy_bands(handoffoverlay[buf], overlayscreen, handoffoverlaypendingleft[buf], handoffoverlaypendingright[buf]);
+        _mark_none(handoffoverlaypendingleft[buf], handoffoverlaypendingright[buf]);
+    }
+
+    // Pack up the view if it was drawn above screen resolution.
+    handoffview[buf].drawn = viewbuffer && viewbufferdrawn;
+    if (handoffview[buf].drawn)
+    {
+        if (!handoffviewbuf[buf])
+        {
+            handoffviewbuf[buf] = malloc(MAXRENDERWIDTH * MAXRENDERHEIGHT);
+        }
+
+        int width = viewwidth << detailshift;
+        for (int y = 0; y < viewheight; y++)
+        {
+            memcpy(handoffviewbuf[buf] + (y * width), viewbuffer + (y * renderwidth), width);
+        }
+
+        handoffview[buf].x = viewwindowx;
+        handoffview[buf].y = viewwindowy;
+        handoffview[buf].width = scaledviewwidth;
+        handoffview[buf].height = scaledviewheight;
+        handoffview[buf].renderwidth = width;
+        handoffview[buf].renderheight = viewheight;
+    }
+    viewbufferdrawn = false;
+
+    // The palette goes up with the frame it was set for.
+    handoffpalette[buf] = palette_wanted;
+
+    // As do the times it was built at.
+    handofftimes[buf].input = controls_input_time;
+    handofftimes[buf].tic = controls_tic_time;
+    handofftimes[buf].rendered = start;
 
     // We got audio, and we got an update finish.
     if (started == 1) { started = 2; }
 
-    // Inform system that we have a new frame.
+    // Hand it off, and inform system that we have a new frame.
     ATOMIC({
+        _merge_dirty(handoffdirtyleft, handoffdirtyright, dirtyleft, dirtyright);
+        _merge_dirty(handoffoverlaydirtyleft, handoffoverlaydirtyright, overlaychangedleft, overlaychangedright);
+        if (handoff_ready >= 0)
+        {
+            // The video thread never got to the last one, it's been replaced.
+            handoff_dropped++;
+        }
+        handoff_ready = buf;
         doom_updates++;
-        whichtex = 1 - whichtex;
     });
+
+    V_ClearDirty();
+    _mark_none(overlaychangedleft, overlaychangedright);
+    uint64_t end = _get_time();
+    handoff_us = (int)(end - start);
+
+    // Hold the main loop back so it samples controls as late as it can.
+    if (uncappedframes)
+    {
+        pacing_sleep_us = _pacing_delay(end);
+        if (pacing_sleep_us > 0)
+        {
+            thread_sleep(pacing_sleep_us);
+        }
+        net_wait_us += pacing_sleep_us;
+        pacing_frame_start = _get_time();
+    }
+    else
+    {
+        pacing_frame_start = end;
+    }
 }
 
 void I_ReadScreen (byte* scr)
 {
     memcpy(scr, screens[0], SCREENWIDTH * SCREENHEIGHT);
+
+    // A view drawn above screen resolution only shows through the window, so
+    // scale it back down into the copy for wipes to use.
+    if (viewbuffer)
+    {
+        int width = viewwidth << detailshift;
+        for (int y = 0; y < scaledviewheight; y++)
+        {
+            byte *dest = scr + ((viewwindowy + y) * SCREENWIDTH) + viewwindowx;
+            byte *src = viewbuffer + (((y * viewheight) / scaledviewheight) * renderwidth);
+
+            for (int x = 0; x < scaledviewwidth; x++)
+            {
+                if (dest[x] == VIEWKEYCOLOR)
+                {
+                    dest[x] = src[(x * width) / scaledviewwidth];
+                }
+            }
+        }
+    }
 }
 
 // Defined in hu_stuff.c
 extern patch_t *hu_font[HU_FONTSIZE];
 
-void V_DrawChar(int x, int y, patch_t *patch, int dbl)
+// Characters drawn in test mode, rasterized once into framebuffer pixels the
+// first time they're drawn at a given scale, and then drawn a run of opaque
+// pixels at a time. Keyed by patch and scale, so callers must hold the patches
+// at PU_STATIC or a purged patch's address could come back as another one.
+// Thrown out when the palette changes since the colors are baked in. The font
+// plus a few skulls fits.
+#define GLYPH_CACHE_SIZE 128
+#define GLYPH_ATLAS_SIZE (64 * 1024)
+
+typedef struct
+{
+    // Where in the atlas this run's pixels start.
+    int offset;
+
+    // Where the run goes, relative to the character's corner.
+    short x;
+    short y;
+    short width;
+} glyph_run_t;
+
+typedef struct
+{
+    patch_t *patch;
+    int dbl;
+    int left;
+    int top;
+    int firstrun;
+    int numruns;
+} glyph_t;
+
+static glyph_t glyphs[GLYPH_CACHE_SIZE];
+static int numglyphs = 0;
+static int glyph_palette = -1;
+static uint16_t *glyph_atlas;
+static int glyph_atlas_used = 0;
+static glyph_run_t *glyph_runs;
+static int glyph_runs_used = 0;
+static int glyph_runs_max = 0;
+
+static void _flush_glyphs()
+{
+    numglyphs = 0;
+    glyph_atlas_used = 0;
+    glyph_runs_used = 0;
+    glyph_palette = palette_loaded;
+}
+
+static uint16_t _glyph_pixel(color_t color)
+{
+    // Test mode draws to a 1555 framebuffer, so match that.
+    return 0x8000 | ((color.r & 0xF8) << 7) | ((color.g & 0xF8) << 2) | ((color.b & 0xF8) >> 3);
+}
+
+static glyph_run_t *_add_glyph_run()
+{
+    if (glyph_runs_used == glyph_runs_max)
+    {
+        glyph_runs_max = glyph_runs_max ? glyph_runs_max * 2 : 1024;
+        glyph_runs = realloc(glyph_runs, sizeof(glyph_run_t) * glyph_runs_max);
+    }
+
+    return &glyph_runs[glyph_runs_used++];
+}
+
+static glyph_t *_rasterize_glyph(patch_t *patch, int dbl)
 {
-    y -= (SHORT(patch->topoffset) * (dbl ? 2 : 1));
-    x -= (SHORT(patch->leftoffset) * (dbl ? 2 : 1));
+    int scale = dbl ? 2 : 1;
+    int width = SHORT(patch->width) * scale;
+
+    // V_DrawPatch draws every post whole, even ones that hang past the
+    // patch's height, so make room for those too.
+    int rows = SHORT(patch->height);
+    for (int col = 0; col < SHORT(patch->width); col++)
+    {
+        column_t *column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
+        while (column->topdelta != 0xff)
+        {
+            if (column->topdelta + column->length > rows)
+            {
+                rows = column->topdelta + column->length;
+            }
+            column = (column_t *)((byte *)column + column->length + 4);
+        }
+    }
 
+    int height = rows * scale;
+    if (width <= 0 || height <= 0 || width * height > GLYPH_ATLAS_SIZE)
+    {
+        return 0;
+    }
+
+    // Start over if it's full, whatever's needed again will come right back.
+    if (numglyphs == GLYPH_CACHE_SIZE || glyph_atlas_used + (width * height) > GLYPH_ATLAS_SIZE)
+    {
+        _flush_glyphs();
+    }
+    if (!glyph_atlas)
+    {
+        glyph_atlas = malloc(sizeof(uint16_t) * GLYPH_ATLAS_SIZE);
+    }
+
+    // Lay the patch out flat first, since it's stored in columns and we want rows.
     uint32_t *bank = ta_palette_bank(TA_PALETTE_CLUT8, 0);
-    int w = SHORT(patch->width);
-    for (int col = 0; col < w; x += (dbl ? 2 : 1), col ++)
+    uint16_t *pixels = glyph_atlas + glyph_atlas_used;
+    byte *opaque = malloc(width * height);
+    memset(opaque, 0, width * height);
+
+    for (int col = 0; col < SHORT(patch->width); col++)
     {
         column_t *column = (column_t *)((byte *)patch + LONG(patch->columnofs[col]));
 
@@ -277,24 +1479,92 @@ void V_DrawChar(int x, int y, patch_t *patch, int dbl)
         while (column->topdelta != 0xff)
         {
             byte *source = (byte *)column + 3;
-            int count = column->length;
-            int row = y + (column->topdelta) * (dbl ? 2 : 1);
-
-            while (count--)
+            for (int i = 0; i < column->length; i++)
             {
-                // Manually scale to 2x
-                color_t color = ta_palette_reverse_entry(bank[*source++]);
-                if (dbl)
+                uint16_t pixel = _glyph_pixel(ta_palette_reverse_entry(bank[source[i]]));
+                int row = (column->topdelta + i) * scale;
+
+                for (int dy = 0; dy < scale; dy++)
                 {
-                    video_draw_pixel(x + 1, row, color);
-                    video_draw_pixel(x, row++, color);
-                    video_draw_pixel(x + 1, row, color);
+                    for (int dx = 0; dx < scale; dx++)
+                    {
+                        int off = ((row + dy) * width) + (col * scale) + dx;
+                        pixels[off] = pixel;
+                        opaque[off] = 1;
+                    }
                 }
-                video_draw_pixel(x, row++, color);
             }
             column = (column_t *)((byte *)column + column->length + 4);
         }
     }
+
+    // Now find the runs of opaque pixels in each row.
+    glyph_t *glyph = &glyphs[numglyphs++];
+    glyph->patch = patch;
+    glyph->dbl = dbl;
+    glyph->left = SHORT(patch->leftoffset) * scale;
+    glyph->top = SHORT(patch->topoffset) * scale;
+    glyph->firstrun = glyph_runs_used;
+
+    for (int y = 0; y < height; y++)
+    {
+        int x = 0;
+        while (x < width)
+        {
+            if (!opaque[(y * width) + x])
+            {
+                x++;
+                continue;
+            }
+
+            glyph_run_t *run = _add_glyph_run();
+            run->offset = glyph_atlas_used + (y * width) + x;
+            run->x = x;
+            run->y = y;
+            while (x < width && opaque[(y * width) + x]) { x++; }
+            run->width = x - run->x;
+        }
+    }
+
+    glyph->numruns = glyph_runs_used - glyph->firstrun;
+    glyph_atlas_used += width * height;
+    free(opaque);
+
+    return glyph;
+}
+
+void V_DrawChar(int x, int y, patch_t *patch, int dbl)
+{
+    if (glyph_palette != palette_loaded)
+    {
+        _flush_glyphs();
+    }
+
+    glyph_t *glyph = 0;
+    for (int i = 0; i < numglyphs; i++)
+    {
+        if (glyphs[i].patch == patch && glyphs[i].dbl == dbl)
+        {
+            glyph = &glyphs[i];
+            break;
+        }
+    }
+    if (!glyph)
+    {
+        glyph = _rasterize_glyph(patch, dbl);
+        if (!glyph)
+        {
+            return;
+        }
+    }
+
+    x -= glyph->left;
+    y -= glyph->top;
+    for (int i = 0; i < glyph->numruns; i++)
+    {
+        glyph_run_t *run = &glyph_runs[glyph->firstrun + i];
+        video_draw_sprite(x + run->x, y + run->y, run->width, 1, glyph_atlas + run->offset);
+    }
 }
 
 void V_DrawText(int x, int y, char *msg, ...)
@@ -30,6 +30,12 @@
 int controls_available = 0;
 int controls_needed = 0;
 
+// When the video thread last polled controls, and when the main thread picked
+// up the ones the current frame is reacting to, for latency measurement.
+uint64_t controls_poll_time = 0;
+uint64_t controls_input_time = 0;
+uint64_t controls_tic_time = 0;
+
 #define STDERR_LEN 8192
 char stderr_buf[STDERR_LEN + 1];
 
@@ -261,6 +267,11 @@ int naomi_get_previous_weapon_button();
 int naomi_get_next_weapon_button();
 int naomi_get_automap_button();
 
+#ifdef NAOMI_DEBUG
+// Defined in r_segs.c, toggled with 1P service to compare wall drawing.
+extern boolean deferwalls;
+#endif
+
 void I_StartTic (void)
 {
     static uint64_t last_forward_press = 0;
@@ -285,6 +296,8 @@ void I_StartTic (void)
     {
         controls_available = 0;
         controls_needed = 1;
+        controls_input_time = controls_poll_time;
+        controls_tic_time = _get_time();
 
         jvs_buttons_t pressed = maple_buttons_pressed();
         jvs_buttons_t released = maple_buttons_released();
@@ -317,6 +330,15 @@ void I_StartTic (void)
             enter_test_mode();
         }
 
+#ifdef NAOMI_DEBUG
+        if (pressed.player1.service)
+        {
+            // Flip between drawing walls as they're found and
+            // deferring them, so both show up in the overlay.
+            deferwalls = !deferwalls;
+        }
+#endif
+
         // "Enter" keypress, mapped to 1P start.
         if (pressed.player1.start)
         {
@@ -805,12 +827,55 @@ typedef struct
     int previous_weapon_button;
     int next_weapon_button;
     int automap_button;
+
+    // Music synthesis quality tier, see i_naomi_music.c.
+    int music_quality;
+
+    // Internal resolution of the 3D view, see i_naomi_video.c.
+    int render_resolution;
+
+    // Whether to draw frames between tics, see i_naomi_video.c.
+    int frame_rate;
+
+    // Whether menus and messages go on their own layer, see i_naomi_video.c.
+    int hud_layer;
+
+    // Whether walls are drawn a texture at a time, see i_naomi_video.c.
+    int wall_drawing;
 } doom_settings_t;
 
-#define DOOM_EEPROM_VER 3
+#define DOOM_EEPROM_VER 8
 #define DOOM_EEPROM_VER1_SIZE 8
 #define DOOM_EEPROM_VER2_SIZE 12
 #define DOOM_EEPROM_VER3_SIZE 18
+#define DOOM_EEPROM_VER4_SIZE 19
+#define DOOM_EEPROM_VER5_SIZE 20
+#define DOOM_EEPROM_VER6_SIZE 21
+#define DOOM_EEPROM_VER7_SIZE 22
+#define DOOM_EEPROM_VER8_SIZE 23
+
+// Must match the quality tiers in i_naomi_music.c.
+#define MUSIC_QUALITY_AUTO 0
+#define MUSIC_QUALITY_MAX 4
+
+// Must match the render resolutions in i_naomi_video.c.
+#define RENDER_RESOLUTION_AUTO 3
+#define RENDER_RESOLUTION_MAX 3
+
+// Must match the frame rates in i_naomi_video.c.
+#define FRAME_RATE_CAPPED 0
+#define FRAME_RATE_UNCAPPED 1
+#define FRAME_RATE_MAX 1
+
+// Must match the HUD layers in i_naomi_video.c.
+#define HUD_LAYER_SOFTWARE 0
+#define HUD_LAYER_HARDWARE 1
+#define HUD_LAYER_MAX 1
+
+// Must match the wall drawing modes in i_naomi_video.c.
+#define WALL_DRAWING_DIRECT 0
+#define WALL_DRAWING_DEFERRED 1
+#define WALL_DRAWING_MAX 1
 
 static int settings_loaded = 0;
 static doom_settings_t settings;
@@ -831,6 +896,11 @@ void naomi_load_default_settings()
     settings.previous_weapon_button = 4;
     settings.next_weapon_button = 5;
     settings.automap_button = 6;
+    settings.music_quality = MUSIC_QUALITY_AUTO;
+    settings.render_resolution = RENDER_RESOLUTION_AUTO;
+    settings.frame_rate = FRAME_RATE_CAPPED;
+    settings.hud_layer = HUD_LAYER_HARDWARE;
+    settings.wall_drawing = WALL_DRAWING_DIRECT;
 }
 
 doom_settings_t *_naomi_load_settings()
@@ -857,6 +927,66 @@ doom_settings_t *_naomi_load_settings()
                     // Cool, let's figure out what version of data this is.
                     switch(eeprom.game.data[4])
                     {
+                        case 8:
+                        {
+                            if (eeprom.game.size >= DOOM_EEPROM_VER8_SIZE)
+                            {
+                                if (eeprom.game.data[22] >= 0 && eeprom.game.data[22] <= WALL_DRAWING_MAX)
+                                {
+                                    settings.wall_drawing = eeprom.game.data[22];
+                                }
+                            }
+
+                            // Fall-through to load other settings.
+                        }
+                        case 7:
+                        {
+                            if (eeprom.game.size >= DOOM_EEPROM_VER7_SIZE)
+                            {
+                                if (eeprom.game.data[21] >= 0 && eeprom.game.data[21] <= HUD_LAYER_MAX)
+                                {
+                                    settings.hud_layer = eeprom.game.data[21];
+                                }
+                            }
+
+                            // Fall-through to load other settings.
+                        }
+                        case 6:
+                        {
+                            if (eeprom.game.size >= DOOM_EEPROM_VER6_SIZE)
+                            {
+                                if (eeprom.game.data[20] >= 0 && eeprom.game.data[20] <= FRAME_RATE_MAX)
+                                {
+                                    settings.frame_rate = eeprom.game.data[20];
+                                }
+                            }
+
+                            // Fall-through to load other settings.
+                        }
+                        case 5:
+                        {
+                            if (eeprom.game.size >= DOOM_EEPROM_VER5_SIZE)
+                            {
+                                if (eeprom.game.data[19] >= 0 && eeprom.game.data[19] <= RENDER_RESOLUTION_MAX)
+                                {
+                                    settings.render_resolution = eeprom.game.data[19];
+                                }
+                            }
+
+                            // Fall-through to load other settings.
+                        }
+                        case 4:
+                        {
+                            if (eeprom.game.size >= DOOM_EEPROM_VER4_SIZE)
+                            {
+                                if (eeprom.game.data[18] >= 0 && eeprom.game.data[18] <= MUSIC_QUALITY_MAX)
+                                {
+                                    settings.music_quality = eeprom.game.data[18];
+                                }
+                            }
+
+                            // Fall-through to load other settings.
+                        }
                         case 3:
                         {
                             if (eeprom.game.size >= DOOM_EEPROM_VER3_SIZE)
@@ -1021,13 +1151,43 @@ int naomi_get_automap_button()
     return cur_settings->automap_button;
 }
 
+int naomi_get_music_quality()
+{
+    doom_settings_t *cur_settings = _naomi_load_settings();
+    return cur_settings->music_quality;
+}
+
+int naomi_get_render_resolution()
+{
+    doom_settings_t *cur_settings = _naomi_load_settings();
+    return cur_settings->render_resolution;
+}
+
+int naomi_get_frame_rate()
+{
+    doom_settings_t *cur_settings = _naomi_load_settings();
+    return cur_settings->frame_rate;
+}
+
+int naomi_get_hud_layer()
+{
+    doom_settings_t *cur_settings = _naomi_load_settings();
+    return cur_settings->hud_layer;
+}
+
+int naomi_get_wall_drawing()
+{
+    doom_settings_t *cur_settings = _naomi_load_settings();
+    return cur_settings->wall_drawing;
+}
+
 void naomi_save_settings()
 {
     eeprom_t eeprom;
     if (eeprom_read(&eeprom) == 0)
     {
         // Format the game settings.
-        eeprom.game.size = DOOM_EEPROM_VER3_SIZE;
+        eeprom.game.size = DOOM_EEPROM_VER8_SIZE;
         memset(eeprom.game.data, 0, eeprom.game.size);
         memcpy(eeprom.game.data, "DOOM", 4);
         eeprom.game.data[4] = DOOM_EEPROM_VER;
@@ -1044,6 +1204,11 @@ void naomi_save_settings()
         eeprom.game.data[15] = settings.previous_weapon_button;
         eeprom.game.data[16] = settings.next_weapon_button;
         eeprom.game.data[17] = settings.automap_button;
+        eeprom.game.data[18] = settings.music_quality;
+        eeprom.game.data[19] = settings.render_resolution;
+        eeprom.game.data[20] = settings.frame_rate;
+        eeprom.game.data[21] = settings.hud_layer;
+        eeprom.game.data[22] = settings.wall_drawing;
 
         // Write it back!
         eeprom_write(&eeprom);
@@ -1131,6 +1296,36 @@ void naomi_set_automap_button(int val)
     settings.automap_button = val;
 }
 
+void naomi_set_music_quality(int val)
+{
+    settings_loaded = 1;
+    settings.music_quality = val;
+}
+
+void naomi_set_render_resolution(int val)
+{
+    settings_loaded = 1;
+    settings.render_resolution = val;
+}
+
+void naomi_set_frame_rate(int val)
+{
+    settings_loaded = 1;
+    settings.frame_rate = val;
+}
+
+void naomi_set_hud_layer(int val)
+{
+    settings_loaded = 1;
+    settings.hud_layer = val;
+}
+
+void naomi_set_wall_drawing(int val)
+{
+    settings_loaded = 1;
+    settings.wall_drawing = val;
+}
+
 // Defined in d_main.c
 extern char *wadfiles[MAXWADFILES];
 void FindResponseFile(void);
@@ -1215,6 +1410,10 @@ int test()
     int defaults_cursor = 0;
     while ( 1 )
     {
+#ifdef NAOMI_DEBUG
+        uint64_t redraw_start = _get_time();
+#endif
+
         // First, poll the buttons and act accordingly.
         maple_poll_buttons();
         jvs_buttons_t buttons = maple_buttons_pressed();
@@ -1307,7 +1506,7 @@ int test()
                     // Also draw the skull to show menu.
                     if (i == main_cursor)
                     {
-                        V_DrawChar(70, top + (i * 20) - 3, W_CacheLumpName(skullName[whichSkull],PU_CACHE), 0);
+                        V_DrawChar(70, top + (i * 20) - 3, W_CacheLumpName(skullName[whichSkull],PU_STATIC), 0);
                     }
                 }
                 break;
@@ -1357,6 +1556,50 @@ int test()
                             break;
                         }
                         case 8:
+                        {
+                            // Music quality setting
+                            if (naomi_get_music_quality() == MUSIC_QUALITY_MAX)
+                            {
+                                naomi_set_music_quality(MUSIC_QUALITY_AUTO);
+                            }
+                            else
+                            {
+                                naomi_set_music_quality(naomi_get_music_quality() + 1);
+                            }
+                            break;
+                        }
+                        case 10:
+                        {
+                            // Render resolution setting
+                            if (naomi_get_render_resolution() == RENDER_RESOLUTION_MAX)
+                            {
+                                naomi_set_render_resolution(0);
+                            }
+                            else
+                            {
+                                naomi_set_render_resolution(naomi_get_render_resolution() + 1);
+                            }
+                            break;
+                        }
+                        case 12:
+                        {
+                            // Frame rate setting
+                            naomi_set_frame_rate(FRAME_RATE_MAX - naomi_get_frame_rate());
+                            break;
+                        }
+                        case 14:
+                        {
+                            // HUD layer setting
+                            naomi_set_hud_layer(HUD_LAYER_MAX - naomi_get_hud_layer());
+                            break;
+                        }
+                        case 16:
+                        {
+                            // Wall drawing setting
+                            naomi_set_wall_drawing(WALL_DRAWING_MAX - naomi_get_wall_drawing());
+                            break;
+                        }
+                        case 18:
                         {
                             // Exit
                             screen = SCREEN_MAIN;
@@ -1398,6 +1641,42 @@ int test()
                             naomi_set_show_options(1 - naomi_get_show_options());
                             break;
                         }
+                        case 8:
+                        {
+                            // Music quality setting
+                            if (naomi_get_music_quality() > MUSIC_QUALITY_AUTO)
+                            {
+                                naomi_set_music_quality(naomi_get_music_quality() - 1);
+                            }
+                            break;
+                        }
+                        case 10:
+                        {
+                            // Render resolution setting
+                            if (naomi_get_render_resolution() > 0)
+                            {
+                                naomi_set_render_resolution(naomi_get_render_resolution() - 1);
+                            }
+                            break;
+                        }
+                        case 12:
+                        {
+                            // Frame rate setting
+                            naomi_set_frame_rate(FRAME_RATE_MAX - naomi_get_frame_rate());
+                            break;
+                        }
+                        case 14:
+                        {
+                            // HUD layer setting
+                            naomi_set_hud_layer(HUD_LAYER_MAX - naomi_get_hud_layer());
+                            break;
+                        }
+                        case 16:
+                        {
+                            // Wall drawing setting
+                            naomi_set_wall_drawing(WALL_DRAWING_MAX - naomi_get_wall_drawing());
+                            break;
+                        }
                     }
                 }
                 if (buttons.player1.right || buttons.player2.right)
@@ -1434,11 +1713,47 @@ int test()
                             naomi_set_show_options(1 - naomi_get_show_options());
                             break;
                         }
+                        case 8:
+                        {
+                            // Music quality setting
+                            if (naomi_get_music_quality() < MUSIC_QUALITY_MAX)
+                            {
+                                naomi_set_music_quality(naomi_get_music_quality() + 1);
+                            }
+                            break;
+                        }
+                        case 10:
+                        {
+                            // Render resolution setting
+                            if (naomi_get_render_resolution() < RENDER_RESOLUTION_MAX)
+                            {
+                                naomi_set_render_resolution(naomi_get_render_resolution() + 1);
+                            }
+                            break;
+                        }
+                        case 12:
+                        {
+                            // Frame rate setting
+                            naomi_set_frame_rate(FRAME_RATE_MAX - naomi_get_frame_rate());
+                            break;
+                        }
+                        case 14:
+                        {
+                            // HUD layer setting
+                            naomi_set_hud_layer(HUD_LAYER_MAX - naomi_get_hud_layer());
+                            break;
+                        }
+                        case 16:
+                        {
+                            // Wall drawing setting
+                            naomi_set_wall_drawing(WALL_DRAWING_MAX - naomi_get_wall_drawing());
+                            break;
+                        }
                     }
                 }
                 else if(buttons.psw2 || buttons.player1.service || buttons.player2.service || buttons.player1.down || buttons.player2.down)
                 {
-                    if (settings_cursor < 8)
+                    if (settings_cursor < 18)
                     {
                         settings_cursor += 2;
                     }
@@ -1466,6 +1781,16 @@ int test()
                     "",
                     "In Game Options: XXXXXX",
                     "",
+                    "Music Quality: XXXXXX",
+                    "",
+                    "Render Resolution: XXXXXXXX",
+                    "",
+                    "Frame Rate: XXXXXXXX",
+                    "",
+                    "HUD Layer: XXXXXXXX",
+                    "",
+                    "Wall Drawing: XXXXXXXX",
+                    "",
                     "Exit",
                 };
 
@@ -1476,6 +1801,28 @@ int test()
                     lines[2] + 12,
                     lines[4] + 14,
                     lines[6] + 17,
+                    lines[8] + 15,
+                    lines[10] + 19,
+                    lines[12] + 12,
+                    lines[14] + 11,
+                    lines[16] + 14,
+                };
+
+                // Display names for each music quality tier.
+                char *music_quality_names[MUSIC_QUALITY_MAX + 1] = {
+                    "Auto",
+                    "High",
+                    "Medium",
+                    "Low",
+                    "Lowest",
+                };
+
+                // Display names for each render resolution.
+                char *render_resolution_names[RENDER_RESOLUTION_MAX + 1] = {
+                    "320x200",
+                    "480x300",
+                    "640x400",
+                    "Auto",
                 };
 
                 // Hack to insert current setting.
@@ -1483,6 +1830,11 @@ int test()
                 sprintf(lineloc[1], "%d/15", naomi_get_sfx_volume());
                 sprintf(lineloc[2], "%d/15", naomi_get_music_volume());
                 strcpy(lineloc[3], naomi_get_show_options() ? "Shown" : "Hidden");
+                strcpy(lineloc[4], music_quality_names[naomi_get_music_quality()]);
+                strcpy(lineloc[5], render_resolution_names[naomi_get_render_resolution()]);
+                strcpy(lineloc[6], naomi_get_frame_rate() == FRAME_RATE_UNCAPPED ? "Uncapped" : "35 FPS");
+                strcpy(lineloc[7], naomi_get_hud_layer() == HUD_LAYER_HARDWARE ? "Hardware" : "Software");
+                strcpy(lineloc[8], naomi_get_wall_drawing() == WALL_DRAWING_DEFERRED ? "Deferred" : "Direct");
 
                 // Draw it doom font style.
                 int top = (video_height() - ((sizeof(lines) / sizeof(lines[0])) * 20)) / 2;
@@ -1493,7 +1845,7 @@ int test()
                     // Also draw the skull to show menu.
                     if (i == settings_cursor)
                     {
-                        V_DrawChar(70, top + (i * 20) - 3, W_CacheLumpName(skullName[whichSkull],PU_CACHE), 0);
+                        V_DrawChar(70, top + (i * 20) - 3, W_CacheLumpName(skullName[whichSkull],PU_STATIC), 0);
                     }
                 }
                 break;
@@ -1745,7 +2097,7 @@ int test()
                             *lineloc[i / 2] = 0;
                         }
 
-                        V_DrawChar(70, top + (i * 20) - 3, W_CacheLumpName(skullName[whichSkull],PU_CACHE), 0);
+                        V_DrawChar(70, top + (i * 20) - 3, W_CacheLumpName(skullName[whichSkull],PU_STATIC), 0);
                     }
 
                     // Draw actual menu text.
@@ -1819,7 +2171,7 @@ int test()
                     // Also draw the skull on no/yes selection.
                     if (i == 8)
                     {
-                        V_DrawChar(70 + (10 * ((defaults_cursor * 8) + 24)), top + (i * 20) - 3, W_CacheLumpName(skullName[whichSkull],PU_CACHE), 0);
+                        V_DrawChar(70 + (10 * ((defaults_cursor * 8) + 24)), top + (i * 20) - 3, W_CacheLumpName(skullName[whichSkull],PU_STATIC), 0);
                     }
                 }
                 break;
@@ -1889,13 +2241,18 @@ int test()
                     // Also draw the skull to show menu.
                     if (i == 7)
                     {
-                        V_DrawChar(70, top + (i * 20) - 3, W_CacheLumpName(skullName[whichSkull],PU_CACHE), 0);
+                        V_DrawChar(70, top + (i * 20) - 3, W_CacheLumpName(skullName[whichSkull],PU_STATIC), 0);
                     }
                 }
                 break;
             }
         }
 
+#ifdef NAOMI_DEBUG
+        // How long the screen took to put together, characters and all.
+        video_draw_debug_text(20, 20, rgb(200, 200, 20), "Redraw: %dus", (int)(_get_time() - redraw_start));
+#endif
+
         // Display it!
         video_display_on_vblank();
 
@@ -115,6 +115,12 @@ typedef enum
 #define SCREENHEIGHT 200
 //(int)(SCREEN_MUL*BASE_WIDTH*INV_ASPECT_RATIO) //200
 
+// The 3D view can be rendered at a higher internal
+//  resolution than the status bar and menus, up to
+//  this size for a full screen view.
+#define MAXRENDERWIDTH  (SCREENWIDTH*2)
+#define MAXRENDERHEIGHT (SCREENHEIGHT*2)
+
 
 
 
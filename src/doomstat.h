@@ -139,11 +139,20 @@ extern  boolean		viewactive;
 extern  boolean		nodrawers;
 extern  boolean		noblit;
 
+// Draw frames between tics, interpolating
+//  from the last tic to the current one.
+extern  boolean		uncappedframes;
+
+// Menus and HUD messages go on their own layer
+//  instead of screen 0, see I_BeginOverlay.
+extern  boolean		hudoverlay;
+
 extern	int		viewwindowx;
 extern	int		viewwindowy;
 extern	int		viewheight;
 extern	int		viewwidth;
 extern	int		scaledviewwidth;
+extern	int		scaledviewheight;
 
 
 
@@ -35,6 +35,21 @@ static const char rcsid[] = "$Id: f_wipe.c,v 1.2 1997/02/03 22:45:09 b1 Exp $";
 
 #include "f_wipe.h"
 
+#ifdef NAOMI_DEBUG
+#include <stdint.h>
+
+// Defined in main.c, for measuring wipes.
+uint64_t _get_time();
+
+// How long the last wipe lasted start to finish, and how much
+//  of that was spent melting rather than running the game.
+int			wipe_us;
+int			wipe_work_us;
+
+static uint64_t		wipe_started;
+static int		wipe_working;
+#endif
+
 //
 //                       SCREEN WIPE PACKAGE
 //
@@ -47,28 +62,6 @@ static byte*	wipe_scr_end;
 static byte*	wipe_scr;
 
 
-void
-wipe_shittyColMajorXform
-( short*	array,
-  int		width,
-  int		height )
-{
-    int		x;
-    int		y;
-    short*	dest;
-
-    dest = (short*) Z_Malloc(width*height*2, PU_STATIC, 0);
-
-    for(y=0;y<height;y++)
-	for(x=0;x<width;x++)
-	    dest[x*height+y] = array[y*width+x];
-
-    memcpy(array, dest, width*height*2);
-
-    Z_Free(dest);
-
-}
-
 int
 wipe_initColorXForm
 ( int	width,
@@ -148,11 +141,6 @@ wipe_initMelt
     // copy start screen to main screen
     memcpy(wipe_scr, wipe_scr_start, width*height);
     
-    // makes this wipe faster (in theory)
-    // to have stuff in column-major format
-    wipe_shittyColMajorXform((short*)wipe_scr_start, width/2, height);
-    wipe_shittyColMajorXform((short*)wipe_scr_end, width/2, height);
-    
     // setup initial column positions
     // (y<0 => not ready to scroll yet)
     y = (int *) Z_Malloc(width*sizeof(int), PU_STATIC, 0);
@@ -197,21 +185,24 @@ wipe_doMelt
 	    {
 		dy = (y[i] < 16) ? y[i]+1 : 8;
 		if (y[i]+dy >= height) dy = height - y[i];
-		s = &((short *)wipe_scr_end)[i*height+y[i]];
+		// both screens stay row-major, stepping down a row
+		//  at a time is cheaper than transposing them up front
+		s = &((short *)wipe_scr_end)[y[i]*width+i];
 		d = &((short *)wipe_scr)[y[i]*width+i];
 		idx = 0;
 		for (j=dy;j;j--)
 		{
-		    d[idx] = *(s++);
+		    d[idx] = s[idx];
 		    idx += width;
 		}
 		y[i] += dy;
-		s = &((short *)wipe_scr_start)[i*height];
+
+		s = &((short *)wipe_scr_start)[i];
 		d = &((short *)wipe_scr)[y[i]*width+i];
 		idx = 0;
 		for (j=height-y[i];j;j--)
 		{
-		    d[idx] = *(s++);
+		    d[idx] = s[idx];
 		    idx += width;
 		}
 		done = false;
@@ -276,10 +267,18 @@ wipe_ScreenWipe
 
     void V_MarkRect(int, int, int, int);
 
+#ifdef NAOMI_DEBUG
+    uint64_t	steptime = _get_time();
+#endif
+
     // initial stuff
     if (!go)
     {
 	go = 1;
+#ifdef NAOMI_DEBUG
+	wipe_started = steptime;
+	wipe_working = 0;
+#endif
 	// wipe_scr = (byte *) Z_Malloc(width*height, PU_STATIC, 0); // DEBUG
 	wipe_scr = screens[0];
 	(*wipes[wipeno*3])(width, height, ticks);
@@ -297,6 +296,15 @@ wipe_ScreenWipe
 	(*wipes[wipeno*3+2])(width, height, ticks);
     }
 
+#ifdef NAOMI_DEBUG
+    wipe_working += (int)(_get_time() - steptime);
+    if (!go)
+    {
+	wipe_us = (int)(_get_time() - wipe_started);
+	wipe_work_us = wipe_working;
+    }
+#endif
+
     return !go;
 
 }
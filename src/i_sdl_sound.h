@@ -38,7 +38,8 @@ I_StartSound(int        id,
             int        vol,
             int        sep,
             int        pitch,
-            int        priority);
+            int        priority,
+            int        positional);
 
 int firstAvailSlot(void);
 
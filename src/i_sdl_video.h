@@ -41,6 +41,11 @@ void I_SetPalette (byte* palette);
 void I_UpdateNoBlit (void);
 void I_FinishUpdate (void);
 
+// Anything drawn to screen 0 in between goes on the
+// overlay layer instead, when hudoverlay is set.
+void I_BeginOverlay (void);
+void I_EndOverlay (void);
+
 // Wait for vertical retrace or pause a bit.
 void I_WaitVBL(int count);
 
@@ -60,13 +60,15 @@ int I_GetSfxLumpNum (sfxinfo_t* sfxinfo );
 
 
 // Starts a sound in a particular sound channel.
+// Sounds that aren't positional stay centered.
 int
 I_StartSound
 ( int		id,
   int		vol,
   int		sep,
   int		pitch,
-  int		priority );
+  int		priority,
+  int		positional );
 
 
 // Stops a sound channel.
@@ -86,6 +88,22 @@ I_UpdateSoundParams
   int		sep,
   int		pitch );
 
+// Parameters for one channel in a batched update.
+typedef struct
+{
+    int		handle;
+    int		vol;
+    int		sep;
+    int		pitch;
+} soundparams_t;
+
+// Updates the volume, separation,
+//  and pitch of several sound channels at once.
+void
+I_UpdateSoundParamsBatch
+( soundparams_t*	params,
+  int		count );
+
 
 //
 //  MUSIC I/O
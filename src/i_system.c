@@ -104,6 +104,22 @@ int  I_GetTime (void)
 }
 
 
+//
+// I_GetTimeFrac
+// returns how far we are into the current tic
+//
+fixed_t I_GetTimeFrac (void)
+{
+    struct timeval	tp;
+    struct timezone	tzp;
+    int			remainder;
+
+    gettimeofday(&tp, &tzp);
+    remainder = (tp.tv_usec*TICRATE) % 1000000;
+    return (fixed_t)(((long long)remainder<<FRACBITS) / 1000000);
+}
+
+
 
 //
 // I_Init
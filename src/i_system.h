@@ -25,6 +25,7 @@
 
 #include "d_ticcmd.h"
 #include "d_event.h"
+#include "m_fixed.h"
 
 #ifdef __GNUG__
 #pragma interface
@@ -44,6 +45,10 @@ byte*	I_ZoneBase (int *size);
 // returns current time in tics.
 int I_GetTime (void);
 
+// Called by R_SetupFrame,
+// returns how far into the current tic we are.
+fixed_t I_GetTimeFrac (void);
+
 
 //
 // Called by D_DoomLoop,
@@ -416,7 +416,12 @@ default_t	defaults[] =
 #endif
     {"detaillevel",&detailLevel, 0},
 
+#ifdef NAOMI_DEBUG
+    // Enough channels to measure positional updates with 8+ sounds.
+    {"snd_channels",&numChannels, 8},
+#else
     {"snd_channels",&numChannels, 3},
+#endif
 
 
 
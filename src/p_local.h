@@ -74,6 +74,11 @@ void P_InitThinkers (void);
 void P_AddThinker (thinker_t* thinker);
 void P_RemoveThinker (thinker_t* thinker);
 
+// for drawing between tics
+extern	fixed_t		oldviewz[MAXPLAYERS];
+
+void P_ResetInterpolation (mobj_t* mo);
+
 
 //
 // P_PSPR
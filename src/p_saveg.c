@@ -24,6 +24,8 @@
 static const char
 rcsid[] = "$Id: p_tick.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
+#include <stddef.h>
+
 #include "i_system.h"
 #include "z_zone.h"
 #include "p_local.h"
@@ -39,6 +41,10 @@ byte*		save_p;
 //  so that the load/save works on SGI&Gecko.
 #define PADSAVEP()	save_p += (4 - ((int) save_p & 3)) & 3
 
+// Interpolation state at the end of a mobj_t isn't
+//  saved, so save games stay compatible.
+#define MOBJSAVESIZE	offsetof(mobj_t, oldx)
+
 
 
 //
@@ -242,8 +248,8 @@ void P_ArchiveThinkers (void)
 	    *save_p++ = tc_mobj;
 	    PADSAVEP();
 	    mobj = (mobj_t *)save_p;
-	    memcpy (mobj, th, sizeof(*mobj));
-	    save_p += sizeof(*mobj);
+	    memcpy (mobj, th, MOBJSAVESIZE);
+	    save_p += MOBJSAVESIZE;
 	    mobj->state = (state_t *)(mobj->state - states);
 	    
 	    if (mobj->player)
@@ -297,8 +303,8 @@ void P_UnArchiveThinkers (void)
 	  case tc_mobj:
 	    PADSAVEP();
 	    mobj = Z_Malloc (sizeof(*mobj), PU_LEVEL, NULL);
-	    memcpy (mobj, save_p, sizeof(*mobj));
-	    save_p += sizeof(*mobj);
+	    memcpy (mobj, save_p, MOBJSAVESIZE);
+	    save_p += MOBJSAVESIZE;
 	    mobj->state = &states[(int)mobj->state];
 	    mobj->target = NULL;
 	    if (mobj->player)
@@ -312,6 +318,7 @@ void P_UnArchiveThinkers (void)
 	    mobj->ceilingz = mobj->subsector->sector->ceilingheight;
 	    mobj->thinker.function.acp1 = (actionf_p1)P_MobjThinker;
 	    P_AddThinker (&mobj->thinker);
+	    P_ResetInterpolation (mobj);
 	    break;
 			
 	  default:
@@ -58,6 +58,7 @@ doom_vertex_t*	vertexes;
 
 int		numsegs;
 seg_t*		segs;
+segrender_t*	segrender;
 
 int		numsectors;
 sector_t*	sectors;
@@ -145,6 +146,7 @@ void P_LoadVertexes (int lump)
     {
 	li->x = SHORT(ml->x)<<FRACBITS;
 	li->y = SHORT(ml->y)<<FRACBITS;
+	li->anglecount = li->distcount = -1;
     }
 
     // Free buffer memory.
@@ -196,6 +198,43 @@ void P_LoadSegs (int lump)
 }
 
 
+//
+// P_InitSegRender
+// Works out everything R_StoreWallRange needs
+//  from a seg that doesn't change with the view.
+//
+void P_InitSegRender (void)
+{
+    int			i;
+    seg_t*		li;
+    segrender_t*	sr;
+
+    segrender = Z_Malloc (numsegs*sizeof(segrender_t),PU_LEVEL,0);
+
+    li = segs;
+    sr = segrender;
+    for (i=0 ; i<numsegs ; i++, li++, sr++)
+    {
+	sr->sidedef = li->sidedef;
+	sr->linedef = li->linedef;
+	sr->normalangle = li->angle + ANG90;
+
+	if (li->v1->y == li->v2->y)
+	    sr->lightadjust = -1;
+	else if (li->v1->x == li->v2->x)
+	    sr->lightadjust = 1;
+	else
+	    sr->lightadjust = 0;
+
+	sr->flags = 0;
+	if (li->linedef->flags & ML_DONTPEGTOP)
+	    sr->flags |= SEGF_DONTPEGTOP;
+	if (li->linedef->flags & ML_DONTPEGBOTTOM)
+	    sr->flags |= SEGF_DONTPEGBOTTOM;
+    }
+}
+
+
 //
 // P_LoadSubsectors
 //
@@ -617,6 +656,8 @@ P_SetupLevel
 #endif
 	Z_FreeTags (PU_LEVEL, PU_PURGELEVEL-1);
 
+    // The planes' flats went with the rest of the level.
+    R_ClearPlaneFlats ();
 
     // UNUSED W_Profile ();
     P_InitThinkers ();
@@ -655,6 +696,7 @@ P_SetupLevel
     P_LoadSubsectors (lumpnum+ML_SSECTORS);
     P_LoadNodes (lumpnum+ML_NODES);
     P_LoadSegs (lumpnum+ML_SEGS);
+    P_InitSegRender ();
 	
     rejectmatrix = W_CacheLumpNum (lumpnum+ML_REJECT,PU_LEVEL);
     P_GroupLines ();
@@ -40,6 +40,9 @@ P_SetupLevel
 // Called by startup code.
 void P_Init (void);
 
+// Called by P_SetupLevel once the segs are loaded.
+void P_InitSegRender (void);
+
 #endif
 //-----------------------------------------------------------------------------
 //
@@ -106,6 +106,9 @@ EV_Teleport
 		thing->z = thing->floorz;  //fixme: not needed?
 		if (thing->player)
 		    thing->player->viewz = thing->z+thing->player->viewheight;
+
+		// don't slide across the map between tics
+		P_ResetInterpolation (thing);
 				
 		// spawn teleport fog at source and destination
 		fog = P_SpawnMobj (oldx, oldy, oldz, MT_TFOG);
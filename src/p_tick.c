@@ -123,6 +123,50 @@ void P_RunThinkers (void)
 
 
 
+//
+// P_ResetInterpolation
+// Draws a thing where it is now, even between tics,
+//  after it first appears or jumps somewhere.
+//
+fixed_t		oldviewz[MAXPLAYERS];
+
+void P_ResetInterpolation (mobj_t* mo)
+{
+    mo->oldx = mo->x;
+    mo->oldy = mo->y;
+    mo->oldz = mo->z;
+    mo->oldangle = mo->angle;
+
+    if (mo->player)
+	oldviewz[mo->player - players] = mo->player->viewz;
+}
+
+
+//
+// P_SaveInterpolation
+// Remembers where everything was at the start of the tic,
+//  for drawing frames between it and the next.
+//
+void P_SaveInterpolation (void)
+{
+    thinker_t*	th;
+    sector_t*	sec;
+    int		i;
+
+    for (th = thinkercap.next ; th != &thinkercap ; th=th->next)
+    {
+	if (th->function.acp1 == (actionf_p1)P_MobjThinker)
+	    P_ResetInterpolation ((mobj_t *)th);
+    }
+
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+	sec->oldfloorheight = sec->floorheight;
+	sec->oldceilingheight = sec->ceilingheight;
+    }
+}
+
+
 //
 // P_Ticker
 //
@@ -131,6 +175,11 @@ void P_Ticker (void)
 {
     int		i;
     
+    // Even a paused tic starts where the last one ended,
+    //  so frames drawn in between hold still.
+    if (uncappedframes)
+	P_SaveInterpolation ();
+
     // run the tic
     if (paused)
 	return;
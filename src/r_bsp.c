@@ -77,21 +77,102 @@ void R_ClearDrawSegs (void)
 // Clips the given range of columns
 // and includes it in the new clip list.
 //
-typedef	struct
+// The columns already covered by solid walls are
+//  kept as a bit each, so runs of them can be found
+//  and tested a word at a time instead of walking
+//  and shuffling a list of ranges.
+//
+#define SOLIDBITS	32
+#define SOLIDWORDS	((MAXRENDERWIDTH+SOLIDBITS-1)/SOLIDBITS)
+
+static unsigned int	solidcols[SOLIDWORDS];
+
+
+//
+// R_FirstColumn
+// Returns the first column from x to last that is
+//  solid (or open, when looking for open ones),
+//  or last+1 if there isn't one.
+//
+static int
+R_FirstColumn
+( int		x,
+  int		last,
+  boolean	solid )
 {
-    int	first;
-    int last;
-    
-} cliprange_t;
+    int			word;
+    unsigned int	bits;
 
+    word = x / SOLIDBITS;
+    bits = solid ? solidcols[word] : ~solidcols[word];
+    bits &= ~0u << (x % SOLIDBITS);
 
-#define MAXSEGS		32
+    while (!bits)
+    {
+	if (++word > last / SOLIDBITS)
+	    return last+1;
+	bits = solid ? solidcols[word] : ~solidcols[word];
+    }
 
-// newend is one past the last valid seg
-cliprange_t*	newend;
-cliprange_t	solidsegs[MAXSEGS];
+    x = word*SOLIDBITS + __builtin_ctz (bits);
+    return x > last ? last+1 : x;
+}
 
 
+//
+// R_MarkSolidColumns
+//
+static void
+R_MarkSolidColumns
+( int	first,
+  int	last )
+{
+    int		word;
+    int		lastword;
+    unsigned int firstmask;
+    unsigned int lastmask;
+
+    word = first / SOLIDBITS;
+    lastword = last / SOLIDBITS;
+    firstmask = ~0u << (first % SOLIDBITS);
+    lastmask = ~0u >> (SOLIDBITS-1 - (last % SOLIDBITS));
+
+    if (word == lastword)
+    {
+	solidcols[word] |= firstmask & lastmask;
+	return;
+    }
+
+    solidcols[word++] |= firstmask;
+    while (word < lastword)
+	solidcols[word++] = ~0u;
+    solidcols[word] |= lastmask;
+}
+
+
+//
+// R_ClipWallSegment
+// Stores every run of columns in the range that
+//  isn't already behind a solid wall, in order.
+//
+static void
+R_ClipWallSegment
+( int	first,
+  int	last )
+{
+    int		x;
+    int		stop;
+
+    x = R_FirstColumn (first, last, false);
+    while (x <= last)
+    {
+	stop = R_FirstColumn (x, last, true);
+	R_StoreWallRange (x, stop-1);
+	if (stop > last)
+	    break;
+	x = R_FirstColumn (stop, last, false);
+    }
+}
 
 
 //
@@ -105,83 +186,8 @@ R_ClipSolidWallSegment
 ( int			first,
   int			last )
 {
-    cliprange_t*	next;
-    cliprange_t*	start;
-
-    // Find the first range that touches the range
-    //  (adjacent pixels are touching).
-    start = solidsegs;
-    while (start->last < first-1)
-	start++;
-
-    if (first < start->first)
-    {
-	if (last < start->first-1)
-	{
-	    // Post is entirely visible (above start),
-	    //  so insert a new clippost.
-	    R_StoreWallRange (first, last);
-	    next = newend;
-	    newend++;
-	    
-	    while (next != start)
-	    {
-		*next = *(next-1);
-		next--;
-	    }
-	    next->first = first;
-	    next->last = last;
-	    return;
-	}
-		
-	// There is a fragment above *start.
-	R_StoreWallRange (first, start->first - 1);
-	// Now adjust the clip size.
-	start->first = first;	
-    }
-
-    // Bottom contained in start?
-    if (last <= start->last)
-	return;			
-		
-    next = start;
-    while (last >= (next+1)->first-1)
-    {
-	// There is a fragment between two posts.
-	R_StoreWallRange (next->last + 1, (next+1)->first - 1);
-	next++;
-	
-	if (last <= next->last)
-	{
-	    // Bottom is contained in next.
-	    // Adjust the clip size.
-	    start->last = next->last;	
-	    goto crunch;
-	}
-    }
-	
-    // There is a fragment after *next.
-    R_StoreWallRange (next->last + 1, last);
-    // Adjust the clip size.
-    start->last = last;
-	
-    // Remove start+1 to next from the clip list,
-    // because start now covers their area.
-  crunch:
-    if (next == start)
-    {
-	// Post just extended past the bottom of one post.
-	return;
-    }
-    
-
-    while (next++ != newend)
-    {
-	// Remove a post.
-	*++start = *next;
-    }
-
-    newend = start+1;
+    R_ClipWallSegment (first, last);
+    R_MarkSolidColumns (first, last);
 }
 
 
@@ -198,43 +204,7 @@ R_ClipPassWallSegment
 ( int	first,
   int	last )
 {
-    cliprange_t*	start;
-
-    // Find the first range that touches the range
-    //  (adjacent pixels are touching).
-    start = solidsegs;
-    while (start->last < first-1)
-	start++;
-
-    if (first < start->first)
-    {
-	if (last < start->first-1)
-	{
-	    // Post is entirely visible (above start).
-	    R_StoreWallRange (first, last);
-	    return;
-	}
-		
-	// There is a fragment above *start.
-	R_StoreWallRange (first, start->first - 1);
-    }
-
-    // Bottom contained in start?
-    if (last <= start->last)
-	return;			
-		
-    while (last >= (start+1)->first-1)
-    {
-	// There is a fragment between two posts.
-	R_StoreWallRange (start->last + 1, (start+1)->first - 1);
-	start++;
-	
-	if (last <= start->last)
-	    return;
-    }
-	
-    // There is a fragment after *next.
-    R_StoreWallRange (start->last + 1, last);
+    R_ClipWallSegment (first, last);
 }
 
 
@@ -244,11 +214,7 @@ R_ClipPassWallSegment
 //
 void R_ClearClipSegs (void)
 {
-    solidsegs[0].first = -0x7fffffff;
-    solidsegs[0].last = -1;
-    solidsegs[1].first = viewwidth;
-    solidsegs[1].last = 0x7fffffff;
-    newend = solidsegs+2;
+    memset (solidcols, 0, sizeof(solidcols));
 }
 
 //
@@ -268,8 +234,8 @@ void R_AddLine (seg_t*	line)
     curline = line;
 
     // OPTIMIZE: quickly reject orthogonal back sides.
-    angle1 = R_PointToAngle (line->v1->x, line->v1->y);
-    angle2 = R_PointToAngle (line->v2->x, line->v2->y);
+    angle1 = R_VertexAngle (line->v1);
+    angle2 = R_VertexAngle (line->v2);
     
     // Clip to view edges.
     // OPTIMIZE: make constant out of 2*clipangle (FIELDOFVIEW).
@@ -394,8 +360,6 @@ boolean R_CheckBBox (fixed_t*	bspcoord)
     angle_t		span;
     angle_t		tspan;
     
-    cliprange_t*	start;
-
     int			sx1;
     int			sx2;
     
@@ -472,16 +436,9 @@ boolean R_CheckBBox (fixed_t*	bspcoord)
 	return false;			
     sx2--;
 	
-    start = solidsegs;
-    while (start->last < sx2)
-	start++;
-    
-    if (sx1 >= start->first
-	&& sx2 <= start->last)
-    {
-	// The clippost contains the new span.
+    // Fully hidden if there's no open column in the span.
+    if (R_FirstColumn (sx1, sx2, false) > sx2)
 	return false;
-    }
 
     return true;
 }
@@ -72,6 +72,15 @@ typedef struct
 {
     fixed_t	x;
     fixed_t	y;
+
+    // Except for the view angle and distance, which
+    //  segs sharing a vertex would otherwise each work
+    //  out again. Only good for the frame they were
+    //  worked out in, see R_VertexAngle.
+    angle_t	viewangle;
+    fixed_t	viewdist;
+    int		anglecount;
+    int		distcount;
     
 } doom_vertex_t;
 
@@ -131,6 +140,13 @@ typedef	struct
 
     int			linecount;
     struct line_s**	lines;	// [linecount] size
+
+    // Heights at the start of the tic, and the real
+    //  ones while drawing between tics.
+    fixed_t	oldfloorheight;
+    fixed_t	oldceilingheight;
+    fixed_t	savedfloorheight;
+    fixed_t	savedceilingheight;
     
 } sector_t;
 
@@ -258,6 +274,30 @@ typedef struct
 } seg_t;
 
 
+//
+// The parts of a seg's render setup that don't
+//  depend on the view, worked out at level load
+//  and kept together, indexed the same as segs.
+//
+#define SEGF_DONTPEGTOP		1
+#define SEGF_DONTPEGBOTTOM	2
+
+typedef struct
+{
+    side_t*	sidedef;
+    line_t*	linedef;
+
+    angle_t	normalangle;
+
+    // Fake contrast, darker along x and lighter along y.
+    short	lightadjust;
+
+    // SEGF_* pegging, from the linedef.
+    short	flags;
+    
+} segrender_t;
+
+
 
 //
 // BSP node.
@@ -467,15 +507,17 @@ typedef struct
   
   // leave pads for [minx-1]/[maxx+1]
   
-  byte		pad1;
+  unsigned short	pad1;
   // Here lies the rub for all
   //  dynamic resize/change of resolution.
-  byte		top[SCREENWIDTH];
-  byte		pad2;
-  byte		pad3;
+  // Sized for the largest internal resolution,
+  //  and wide enough to hold its rows.
+  unsigned short	top[MAXRENDERWIDTH];
+  unsigned short	pad2;
+  unsigned short	pad3;
   // See above.
-  byte		bottom[SCREENWIDTH];
-  byte		pad4;
+  unsigned short	bottom[MAXRENDERWIDTH];
+  unsigned short	pad4;
 
 } visplane_t;
 
@@ -28,6 +28,8 @@ static const char
 rcsid[] = "$Id: r_draw.c,v 1.4 1997/02/03 16:47:55 b1 Exp $";
 
 
+#include <stdlib.h>
+
 #include "doomdef.h"
 
 #include "i_system.h"
@@ -64,11 +66,30 @@ byte*		viewimage;
 int		viewwidth;
 int		scaledviewwidth;
 int		viewheight;
+int		scaledviewheight;
 int		viewwindowx;
 int		viewwindowy; 
 byte*		ylookup[MAXHEIGHT]; 
 int		columnofs[MAXWIDTH]; 
 
+// Internal resolution of a full screen view.
+// Above SCREENWIDTH x SCREENHEIGHT the view is drawn
+//  into viewbuffer instead of screens[0], and the
+//  video hardware scales it down under the window.
+int		renderwidth = SCREENWIDTH;
+int		renderheight = SCREENHEIGHT;
+byte*		viewbuffer;
+boolean		viewbufferdrawn;
+
+// Room for the largest view, taken once from outside the
+//  zone and kept, so changing resolution mid level doesn't
+//  have to find a big block in it every time.
+static byte*	viewbufferdata;
+
+// Identity, except for VIEWKEYCOLOR, which maps to the
+//  closest color that isn't it.
+byte		viewkeymap[256];
+
 // Color tables for different players,
 //  translate a limited part to another
 //  (color ramps used for  suit colors).
@@ -108,6 +129,7 @@ void R_DrawColumn (void)
     byte*		dest; 
     fixed_t		frac;
     fixed_t		fracstep;	 
+    int			stride;
  
     count = dc_yh - dc_yl; 
 
@@ -116,9 +138,9 @@ void R_DrawColumn (void)
 	return; 
 				 
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
+    if ((unsigned)dc_x >= renderwidth
 	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT) 
+	|| dc_yh >= renderheight) 
 	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x); 
 #endif 
 
@@ -126,6 +148,7 @@ void R_DrawColumn (void)
     // Use ylookup LUT to avoid multiply with ScreenWidth.
     // Use columnofs LUT for subwindows? 
     dest = ylookup[dc_yl] + columnofs[dc_x];  
+    stride = renderwidth;
 
     // Determine scaling,
     //  which is the only mapping to be done.
@@ -141,7 +164,7 @@ void R_DrawColumn (void)
 	//  using a lighting/special effects LUT.
 	*dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
 	
-	dest += SCREENWIDTH; 
+	dest += stride; 
 	frac += fracstep;
 	
     } while (count--); 
@@ -215,6 +238,7 @@ void R_DrawColumnLow (void)
     byte*		dest2;
     fixed_t		frac;
     fixed_t		fracstep;	 
+    int			stride;
  
     count = dc_yh - dc_yl; 
 
@@ -223,9 +247,9 @@ void R_DrawColumnLow (void)
 	return; 
 				 
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
+    if ((unsigned)dc_x >= renderwidth
 	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
+	|| dc_yh >= renderheight)
     {
 	
 	I_Error ("R_DrawColumn: %i to %i at %i", dc_yl, dc_yh, dc_x);
@@ -237,6 +261,7 @@ void R_DrawColumnLow (void)
     
     dest = ylookup[dc_yl] + columnofs[dc_x];
     dest2 = ylookup[dc_yl] + columnofs[dc_x+1];
+    stride = renderwidth;
     
     fracstep = dc_iscale; 
     frac = dc_texturemid + (dc_yl-centery)*fracstep;
@@ -245,8 +270,8 @@ void R_DrawColumnLow (void)
     {
 	// Hack. Does not work corretly.
 	*dest2 = *dest = dc_colormap[dc_source[(frac>>FRACBITS)&127]];
-	dest += SCREENWIDTH;
-	dest2 += SCREENWIDTH;
+	dest += stride;
+	dest2 += stride;
 	frac += fracstep; 
 
     } while (count--);
@@ -260,6 +285,8 @@ void R_DrawColumnLow (void)
 #define FUZZOFF	(SCREENWIDTH)
 
 
+
+// Rescaled to the row stride by R_InitBuffer.
 int	fuzzoffset[FUZZTABLE] =
 {
     FUZZOFF,-FUZZOFF,FUZZOFF,-FUZZOFF,FUZZOFF,FUZZOFF,-FUZZOFF,
@@ -285,9 +312,11 @@ int	fuzzpos = 0;
 void R_DrawFuzzColumn (void) 
 { 
     int			count; 
+    int			run;
     byte*		dest; 
-    fixed_t		frac;
-    fixed_t		fracstep;	 
+    int*		offset;
+    lighttable_t*	fuzzmap;
+    int			stride;
 
     // Adjust borders. Low... 
     if (!dc_yl) 
@@ -305,8 +334,8 @@ void R_DrawFuzzColumn (void)
 
     
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
-	|| dc_yl < 0 || dc_yh >= SCREENHEIGHT)
+    if ((unsigned)dc_x >= renderwidth
+	|| dc_yl < 0 || dc_yh >= renderheight)
     {
 	I_Error ("R_DrawFuzzColumn: %i to %i at %i",
 		 dc_yl, dc_yh, dc_x);
@@ -341,30 +370,49 @@ void R_DrawFuzzColumn (void)
     
     // Does not work with blocky mode.
     dest = ylookup[dc_yl] + columnofs[dc_x];
-
-    // Looks familiar.
-    fracstep = dc_iscale; 
-    frac = dc_texturemid + (dc_yl-centery)*fracstep; 
+    stride = renderwidth;
 
     // Looks like an attempt at dithering,
     //  using the colormap #6 (of 0-31, a bit
     //  brighter than average).
-    do 
+    // The column goes in runs that end where the
+    //  fuzz table wraps, so the inner loop only has
+    //  to step along the table, not check it too.
+    fuzzmap = colormaps + 6*256;
+    count++;
+
+    while (count)
     {
+	run = FUZZTABLE - fuzzpos;
+	if (run > count)
+	    run = count;
+	count -= run;
+
+	offset = fuzzoffset + fuzzpos;
+	fuzzpos += run;
+	if (fuzzpos == FUZZTABLE)
+	    fuzzpos = 0;
+
 	// Lookup framebuffer, and retrieve
-	//  a pixel that is either one column
-	//  left or right of the current one.
+	//  a pixel that is either one row
+	//  above or below the current one.
 	// Add index from colormap to index.
-	*dest = colormaps[6*256+dest[fuzzoffset[fuzzpos]]]; 
-
-	// Clamp table lookup index.
-	if (++fuzzpos == FUZZTABLE) 
-	    fuzzpos = 0;
-	
-	dest += SCREENWIDTH;
+	while (run >= 2)
+	{
+	    dest[0] = fuzzmap[dest[offset[0]]];
+	    dest += stride;
+	    dest[0] = fuzzmap[dest[offset[1]]];
+	    dest += stride;
+	    offset += 2;
+	    run -= 2;
+	}
 
-	frac += fracstep; 
-    } while (count--); 
+	if (run)
+	{
+	    *dest = fuzzmap[dest[*offset]];
+	    dest += stride;
+	}
+    }
 } 
  
   
@@ -382,21 +430,30 @@ void R_DrawFuzzColumn (void)
 byte*	dc_translation;
 byte*	translationtables;
 
+// The translation run through the colormap, so each pixel
+//  takes one lookup instead of two. Rebuilt only when the
+//  sprite being drawn has a different pair.
+static lighttable_t	translatedmap[256];
+static lighttable_t*	translatedcolormap;
+static byte*		translatedtranslation;
+
 void R_DrawTranslatedColumn (void) 
 { 
     int			count; 
+    int			i;
     byte*		dest; 
     fixed_t		frac;
     fixed_t		fracstep;	 
+    int			stride;
  
     count = dc_yh - dc_yl; 
     if (count < 0) 
 	return; 
 				 
 #ifdef RANGECHECK 
-    if ((unsigned)dc_x >= SCREENWIDTH
+    if ((unsigned)dc_x >= renderwidth
 	|| dc_yl < 0
-	|| dc_yh >= SCREENHEIGHT)
+	|| dc_yh >= renderheight)
     {
 	I_Error ( "R_DrawColumn: %i to %i at %i",
 		  dc_yl, dc_yh, dc_x);
@@ -424,8 +481,18 @@ void R_DrawTranslatedColumn (void)
     }*/
 
     
+    if (dc_colormap != translatedcolormap
+	|| dc_translation != translatedtranslation)
+    {
+	for (i=0 ; i<256 ; i++)
+	    translatedmap[i] = dc_colormap[dc_translation[i]];
+	translatedcolormap = dc_colormap;
+	translatedtranslation = dc_translation;
+    }
+
     // FIXME. As above.
     dest = ylookup[dc_yl] + columnofs[dc_x]; 
+    stride = renderwidth;
 
     // Looks familiar.
     fracstep = dc_iscale; 
@@ -439,8 +506,8 @@ void R_DrawTranslatedColumn (void)
 	//  used with PLAY sprites.
 	// Thus the "green" ramp of the player 0 sprite
 	//  is mapped to gray, red, black/indigo. 
-	*dest = dc_colormap[dc_translation[dc_source[frac>>FRACBITS]]];
-	dest += SCREENWIDTH;
+	*dest = translatedmap[dc_source[frac>>FRACBITS]];
+	dest += stride;
 	
 	frac += fracstep; 
     } while (count--); 
@@ -528,8 +595,8 @@ void R_DrawSpan (void)
 #ifdef RANGECHECK 
     if (ds_x2 < ds_x1
 	|| ds_x1<0
-	|| ds_x2>=SCREENWIDTH  
-	|| (unsigned)ds_y>SCREENHEIGHT)
+	|| ds_x2>=renderwidth  
+	|| (unsigned)ds_y>renderheight)
     {
 	I_Error( "R_DrawSpan: %i to %i at %i",
 		 ds_x1,ds_x2,ds_y);
@@ -651,8 +718,8 @@ void R_DrawSpanLow (void)
 #ifdef RANGECHECK 
     if (ds_x2 < ds_x1
 	|| ds_x1<0
-	|| ds_x2>=SCREENWIDTH  
-	|| (unsigned)ds_y>SCREENHEIGHT)
+	|| ds_x2>=renderwidth  
+	|| (unsigned)ds_y>renderheight)
     {
 	I_Error( "R_DrawSpan: %i to %i at %i",
 		 ds_x1,ds_x2,ds_y);
@@ -685,6 +752,51 @@ void R_DrawSpanLow (void)
     } while (count--); 
 }
 
+//
+// R_InitViewKeyMap
+// Graphics can use VIEWKEYCOLOR as well, so while the
+//  view shows through it they get drawn with a stand in.
+//
+static void R_InitViewKeyMap (void)
+{
+    byte*	playpal;
+    byte*	key;
+    byte*	c;
+    int		i;
+    int		d;
+    int		dist;
+    int		best;
+    int		bestdist;
+
+    playpal = W_CacheLumpName ("PLAYPAL",PU_CACHE);
+    key = playpal + VIEWKEYCOLOR*3;
+    best = 0;
+    bestdist = MAXINT;
+
+    for (i=0 ; i<256 ; i++)
+    {
+	viewkeymap[i] = i;
+	if (i == VIEWKEYCOLOR)
+	    continue;
+
+	c = playpal + i*3;
+	d = c[0] - key[0];
+	dist = d*d;
+	d = c[1] - key[1];
+	dist += d*d;
+	d = c[2] - key[2];
+	dist += d*d;
+
+	if (dist < bestdist)
+	{
+	    best = i;
+	    bestdist = dist;
+	}
+    }
+    viewkeymap[VIEWKEYCOLOR] = best;
+}
+
+
 //
 // R_InitBuffer 
 // Creats lookup tables that avoid
@@ -704,19 +816,48 @@ R_InitBuffer
     //  with border and/or status bar.
     viewwindowx = (SCREENWIDTH-width) >> 1; 
 
-    // Column offset. For windows.
-    for (i=0 ; i<width ; i++) 
-	columnofs[i] = viewwindowx + i;
-
     // Samw with base row offset.
     if (width == SCREENWIDTH) 
 	viewwindowy = 0; 
     else 
 	viewwindowy = (SCREENHEIGHT-SBARHEIGHT-height) >> 1; 
 
-    // Preclaculate all row offsets.
-    for (i=0 ; i<height ; i++) 
-	ylookup[i] = screens[0] + (i+viewwindowy)*SCREENWIDTH; 
+    if (renderwidth != SCREENWIDTH || renderheight != SCREENHEIGHT)
+    {
+	// Draw into the top left of a buffer of our own,
+	//  scaled down to the window when it is displayed.
+	if (!viewbufferdata)
+	{
+	    viewbufferdata = malloc (MAXRENDERWIDTH*MAXRENDERHEIGHT);
+	    if (!viewbufferdata)
+		I_Error ("R_InitBuffer: no memory for the view buffer");
+	    R_InitViewKeyMap ();
+	}
+	viewbuffer = viewbufferdata;
+
+	for (i=0 ; i<viewwidth<<detailshift ; i++) 
+	    columnofs[i] = i;
+
+	for (i=0 ; i<viewheight ; i++) 
+	    ylookup[i] = viewbuffer + i*renderwidth; 
+    }
+    else
+    {
+	viewbuffer = NULL;
+
+	// Column offset. For windows.
+	for (i=0 ; i<width ; i++) 
+	    columnofs[i] = viewwindowx + i;
+
+	// Preclaculate all row offsets.
+	for (i=0 ; i<height ; i++) 
+	    ylookup[i] = screens[0] + (i+viewwindowy)*SCREENWIDTH; 
+    }
+    viewbufferdrawn = false;
+
+    // Fuzz samples the rows above and below.
+    for (i=0 ; i<FUZZTABLE ; i++)
+	fuzzoffset[i] = fuzzoffset[i] > 0 ? renderwidth : -renderwidth;
 } 
  
  
@@ -777,14 +918,14 @@ void R_FillBackScreen (void)
     patch = W_CacheLumpName ("brdr_b",PU_CACHE);
 
     for (x=0 ; x<scaledviewwidth ; x+=8)
-	V_DrawPatch (viewwindowx+x,viewwindowy+viewheight,1,patch);
+	V_DrawPatch (viewwindowx+x,viewwindowy+scaledviewheight,1,patch);
     patch = W_CacheLumpName ("brdr_l",PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
+    for (y=0 ; y<scaledviewheight ; y+=8)
 	V_DrawPatch (viewwindowx-8,viewwindowy+y,1,patch);
     patch = W_CacheLumpName ("brdr_r",PU_CACHE);
 
-    for (y=0 ; y<viewheight ; y+=8)
+    for (y=0 ; y<scaledviewheight ; y+=8)
 	V_DrawPatch (viewwindowx+scaledviewwidth,viewwindowy+y,1,patch);
 
 
@@ -800,12 +941,12 @@ void R_FillBackScreen (void)
 		 W_CacheLumpName ("brdr_tr",PU_CACHE));
     
     V_DrawPatch (viewwindowx-8,
-		 viewwindowy+viewheight,
+		 viewwindowy+scaledviewheight,
 		 1,
 		 W_CacheLumpName ("brdr_bl",PU_CACHE));
     
     V_DrawPatch (viewwindowx+scaledviewwidth,
-		 viewwindowy+viewheight,
+		 viewwindowy+scaledviewheight,
 		 1,
 		 W_CacheLumpName ("brdr_br",PU_CACHE));
 } 
@@ -824,7 +965,28 @@ R_VideoErase
   //  is not optiomal, e.g. byte by byte on
   //  a 32bit CPU, as GNU GCC/Linux libc did
   //  at one point.
-    memcpy (screens[0]+ofs, screens[1]+ofs, count); 
+    if (viewbuffer)
+    {
+	byte*	dest = screens[0]+ofs;
+	byte*	src = screens[1]+ofs;
+	int	i;
+
+	for (i=0 ; i<count ; i++)
+	    dest[i] = viewkeymap[src[i]];
+    }
+    else
+	memcpy (screens[0]+ofs, screens[1]+ofs, count); 
+
+    if (count > 0)
+    {
+	int	y = ofs/SCREENWIDTH;
+	int	lasty = (ofs+count-1)/SCREENWIDTH;
+
+	if (y == lasty)
+	    V_MarkRect (ofs%SCREENWIDTH, y, count, 1);
+	else
+	    V_MarkRect (0, y, SCREENWIDTH, lasty-y+1);
+    }
 } 
 
 
@@ -850,21 +1012,21 @@ void R_DrawViewBorder (void)
     if (scaledviewwidth == SCREENWIDTH) 
 	return; 
   
-    top = ((SCREENHEIGHT-SBARHEIGHT)-viewheight)/2; 
+    top = ((SCREENHEIGHT-SBARHEIGHT)-scaledviewheight)/2; 
     side = (SCREENWIDTH-scaledviewwidth)/2; 
  
     // copy top and one line of left side 
     R_VideoErase (0, top*SCREENWIDTH+side); 
  
     // copy one line of right side and bottom 
-    ofs = (viewheight+top)*SCREENWIDTH-side; 
+    ofs = (scaledviewheight+top)*SCREENWIDTH-side; 
     R_VideoErase (ofs, top*SCREENWIDTH+side); 
  
     // copy sides using wraparound 
     ofs = top*SCREENWIDTH + SCREENWIDTH-side; 
     side <<= 1;
     
-    for (i=1 ; i<viewheight ; i++) 
+    for (i=1 ; i<scaledviewheight ; i++) 
     { 
 	R_VideoErase (ofs, side); 
 	ofs += SCREENWIDTH; 
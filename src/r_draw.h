@@ -78,6 +78,25 @@ extern byte*		ds_source;
 extern byte*		translationtables;
 extern byte*		dc_translation;
 
+// Internal resolution of a full screen view,
+//  see R_SetRenderResolution.
+extern int		renderwidth;
+extern int		renderheight;
+
+// Non-NULL when the view is drawn above screen
+//  resolution, and set when a frame was drawn to it.
+extern byte*		viewbuffer;
+extern boolean		viewbufferdrawn;
+
+// Left in the view window of screens[0] where
+//  viewbuffer should show through. Black.
+#define VIEWKEYCOLOR		247
+
+// Anything else drawn to screens[0] while viewbuffer
+//  is set goes through this, so the key is left for
+//  the view window alone.
+extern byte		viewkeymap[256];
+
 
 // Span blitting for rows, floor/ceiling.
 // No Sepctre effect needed.
@@ -33,12 +33,57 @@ static const char rcsid[] = "$Id: r_main.c,v 1.5 1997/02/03 22:45:12 b1 Exp $";
 
 
 #include "doomdef.h"
+#include "doomstat.h"
 #include "d_net.h"
+#include "i_system.h"
+#include "z_zone.h"
 
 #include "m_bbox.h"
 
+#include "p_local.h"
+
 #include "r_local.h"
 #include "r_sky.h"
+#include "v_video.h"
+
+#ifdef NAOMI
+#include <stdint.h>
+
+// Defined in main.c, for measuring render cost.
+uint64_t _get_time();
+
+// Time spent in the last R_RenderPlayerView, and how many
+//  there have been, for the debug overlay and resolution governor.
+int			r_render_us;
+int			r_render_frames;
+#endif
+
+#ifdef NAOMI_DEBUG
+// How many view angles the last frame worked out, and how
+//  many it got from vertexes that already had theirs.
+int			r_angle_calls;
+int			r_angle_cached;
+static int		anglecalls;
+static int		anglecached;
+
+// Time the last frame spent setting up wall ranges,
+//  and drawing the walls it deferred.
+int			r_storewall_frame_us;
+int			r_deferwalls_frame_us;
+
+// Time the last frame spent on sprites and masked walls,
+//  and how many sprites and drawsegs it had.
+int			r_masked_frame_us;
+int			r_masked_sprites;
+int			r_masked_drawsegs;
+
+// Time the last frame spent drawing sky, and how many columns.
+int			r_sky_frame_us;
+int			r_sky_frame_columns;
+
+// Zone tag changes the last frame made.
+int			r_tagchanges_frame;
+#endif
 
 
 
@@ -51,6 +96,8 @@ static const char rcsid[] = "$Id: r_main.c,v 1.5 1997/02/03 22:45:12 b1 Exp $";
 
 int			viewangleoffset;
 
+fixed_t			fractionaltic = FRACUNIT;
+
 // increment every time a check is made
 int			validcount = 1;		
 
@@ -100,7 +147,7 @@ int			viewangletox[FINEANGLES/2];
 // The xtoviewangleangle[] table maps a screen pixel
 // to the lowest viewangle that maps back to x ranges
 // from clipangle to -clipangle.
-angle_t			xtoviewangle[SCREENWIDTH+1];
+angle_t			xtoviewangle[MAXRENDERWIDTH+1];
 
 
 // UNUSED.
@@ -293,6 +340,9 @@ R_PointToAngle
 ( fixed_t	x,
   fixed_t	y )
 {	
+#ifdef NAOMI_DEBUG
+    anglecalls++;
+#endif
     x -= viewx;
     y -= viewy;
     
@@ -388,6 +438,41 @@ R_PointToAngle2
 }
 
 
+//
+// R_VertexAngle
+// R_PointToAngle for a vertex, kept for the rest
+//  of the frame since neighbouring segs share them.
+//
+angle_t R_VertexAngle (doom_vertex_t* v)
+{
+    if (v->anglecount != framecount)
+    {
+	v->viewangle = R_PointToAngle (v->x, v->y);
+	v->anglecount = framecount;
+    }
+#ifdef NAOMI_DEBUG
+    else
+	anglecached++;
+#endif
+    return v->viewangle;
+}
+
+
+//
+// R_VertexDist
+// Likewise for R_PointToDist.
+//
+fixed_t R_VertexDist (doom_vertex_t* v)
+{
+    if (v->distcount != framecount)
+    {
+	v->viewdist = R_PointToDist (v->x, v->y);
+	v->distcount = framecount;
+    }
+    return v->viewdist;
+}
+
+
 fixed_t
 R_PointToDist
 ( fixed_t	x,
@@ -669,6 +754,46 @@ R_SetViewSize
 }
 
 
+//
+// R_ForceLowDetail
+// Drops to low detail regardless of the menu setting,
+//  without changing it.
+//
+boolean		forcelowdetail;
+
+void R_ForceLowDetail (boolean force)
+{
+    if (force == forcelowdetail)
+	return;
+
+    forcelowdetail = force;
+    setsizeneeded = true;
+}
+
+
+//
+// R_SetRenderResolution
+// Sets the internal resolution of a full screen view.
+// Also takes effect at the next frame refresh.
+//
+void
+R_SetRenderResolution
+( int		width,
+  int		height )
+{
+    if (width < SCREENWIDTH || width > MAXRENDERWIDTH
+	|| height < SCREENHEIGHT || height > MAXRENDERHEIGHT)
+	I_Error ("R_SetRenderResolution: %ix%i not supported", width, height);
+
+    if (width == renderwidth && height == renderheight)
+	return;
+
+    renderwidth = width;
+    renderheight = height;
+    setsizeneeded = true;
+}
+
+
 //
 // R_ExecuteSetViewSize
 //
@@ -686,16 +811,19 @@ void R_ExecuteSetViewSize (void)
     if (setblocks == MAX_SCREEN_BLOCKS)
     {
 	scaledviewwidth = SCREENWIDTH;
-	viewheight = SCREENHEIGHT;
+	scaledviewheight = SCREENHEIGHT;
     }
     else
     {
 	scaledviewwidth = setblocks*32;
-	viewheight = (setblocks*168/10)&~7;
+	scaledviewheight = (setblocks*168/10)&~7;
     }
     
-    detailshift = setdetail;
-    viewwidth = scaledviewwidth>>detailshift;
+    // The window is laid out on screen, but drawn
+    //  at the internal resolution.
+    detailshift = setdetail || forcelowdetail;
+    viewwidth = (scaledviewwidth*renderwidth/SCREENWIDTH)>>detailshift;
+    viewheight = scaledviewheight*renderheight/SCREENHEIGHT;
 	
     centery = viewheight/2;
     centerx = viewwidth/2;
@@ -718,7 +846,7 @@ void R_ExecuteSetViewSize (void)
 	spanfunc = R_DrawSpanLow;
     }
 
-    R_InitBuffer (scaledviewwidth, viewheight);
+    R_InitBuffer (scaledviewwidth, scaledviewheight);
 	
     R_InitTextureMapping ();
     
@@ -836,12 +964,25 @@ void R_SetupFrame (player_t* player)
     int		i;
     
     viewplayer = player;
-    viewx = player->mo->x;
-    viewy = player->mo->y;
-    viewangle = player->mo->angle + viewangleoffset;
     extralight = player->extralight;
 
-    viewz = player->viewz;
+    if (uncappedframes)
+    {
+	fractionaltic = I_GetTimeFrac ();
+	viewx = R_LERP(player->mo->oldx, player->mo->x);
+	viewy = R_LERP(player->mo->oldy, player->mo->y);
+	viewangle = player->mo->oldangle
+	    + FixedMul (player->mo->angle - player->mo->oldangle, fractionaltic)
+	    + viewangleoffset;
+	viewz = R_LERP(oldviewz[player - players], player->viewz);
+    }
+    else
+    {
+	viewx = player->mo->x;
+	viewy = player->mo->y;
+	viewangle = player->mo->angle + viewangleoffset;
+	viewz = player->viewz;
+    }
     
     viewsin = finesine[viewangle>>ANGLETOFINESHIFT];
     viewcos = finecosine[viewangle>>ANGLETOFINESHIFT];
@@ -868,13 +1009,69 @@ void R_SetupFrame (player_t* player)
 
 
 
+//
+// R_InterpolateSectors
+// Moves floors and ceilings part way through the tic
+//  for a frame drawn between tics.
+//
+void R_InterpolateSectors (void)
+{
+    sector_t*	sec;
+    int		i;
+
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+	sec->savedfloorheight = sec->floorheight;
+	sec->savedceilingheight = sec->ceilingheight;
+
+	if (sec->oldfloorheight != sec->floorheight)
+	    sec->floorheight = R_LERP(sec->oldfloorheight, sec->floorheight);
+	if (sec->oldceilingheight != sec->ceilingheight)
+	    sec->ceilingheight = R_LERP(sec->oldceilingheight, sec->ceilingheight);
+    }
+}
+
+
+//
+// R_RestoreSectors
+// Puts them back for the playsim.
+//
+void R_RestoreSectors (void)
+{
+    sector_t*	sec;
+    int		i;
+
+    for (i=0, sec=sectors ; i<numsectors ; i++, sec++)
+    {
+	sec->floorheight = sec->savedfloorheight;
+	sec->ceilingheight = sec->savedceilingheight;
+    }
+}
+
+
 //
 // R_RenderView
 //
 void R_RenderPlayerView (player_t* player)
 {	
+#ifdef NAOMI
+    uint64_t	starttime = _get_time();
+#endif
+#ifdef NAOMI_DEBUG
+    anglecalls = anglecached = 0;
+    r_storewall_us = 0;
+    r_deferwalls_us = 0;
+    r_sky_us = 0;
+    r_sky_columns = 0;
+    int		tagchanges = z_tagchanges;
+#endif
+    int		y;
+
     R_SetupFrame (player);
 
+    if (uncappedframes)
+	R_InterpolateSectors ();
+
     // Clear buffers.
     R_ClearClipSegs ();
     R_ClearDrawSegs ();
@@ -886,6 +1083,9 @@ void R_RenderPlayerView (player_t* player)
 
     // The head node is the last node output.
     R_RenderBSPNode (numnodes-1);
+
+    // Draw any walls the BSP walk held back.
+    R_DrawDeferredWalls ();
     
     // Check for new console commands.
     NetUpdate ();
@@ -895,7 +1095,45 @@ void R_RenderPlayerView (player_t* player)
     // Check for new console commands.
     NetUpdate ();
     
+#ifdef NAOMI_DEBUG
+    uint64_t	maskedtime = _get_time();
+#endif
     R_DrawMasked ();
+#ifdef NAOMI_DEBUG
+    r_masked_frame_us = (int)(_get_time() - maskedtime);
+    r_masked_sprites = vissprite_p - vissprites;
+    r_masked_drawsegs = ds_p - drawsegs;
+#endif
+
+    // Let a view drawn into its own buffer show through
+    //  the window, under anything drawn on top later.
+    if (viewbuffer)
+    {
+	for (y=0 ; y<scaledviewheight ; y++)
+	    memset (screens[0]+(viewwindowy+y)*SCREENWIDTH+viewwindowx,
+		    VIEWKEYCOLOR, scaledviewwidth);
+	viewbufferdrawn = true;
+    }
+
+    if (uncappedframes)
+	R_RestoreSectors ();
+
+    // The whole view window was drawn over.
+    V_MarkRect (viewwindowx, viewwindowy, scaledviewwidth, scaledviewheight);
+
+#ifdef NAOMI
+    r_render_us = (int)(_get_time() - starttime);
+    r_render_frames++;
+#endif
+#ifdef NAOMI_DEBUG
+    r_angle_calls = anglecalls;
+    r_angle_cached = anglecached;
+    r_storewall_frame_us = r_storewall_us;
+    r_deferwalls_frame_us = r_deferwalls_us;
+    r_sky_frame_us = r_sky_us;
+    r_sky_frame_columns = r_sky_columns;
+    r_tagchanges_frame = z_tagchanges - tagchanges;
+#endif
 
     // Check for new console commands.
     NetUpdate ();				
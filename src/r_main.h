@@ -52,6 +52,12 @@ extern fixed_t		centerxfrac;
 extern fixed_t		centeryfrac;
 extern fixed_t		projection;
 
+// How far between the last tic and the current one
+//  this frame is drawn, FRACUNIT unless uncapped.
+extern fixed_t		fractionaltic;
+
+#define R_LERP(old,cur)	((old) + FixedMul((cur)-(old), fractionaltic))
+
 extern int		validcount;
 
 extern int		linecount;
@@ -135,6 +141,11 @@ R_PointToDist
 ( fixed_t	x,
   fixed_t	y );
 
+// Same as the above for a vertex, but only
+//  worked out once a frame.
+angle_t R_VertexAngle (doom_vertex_t* v);
+fixed_t R_VertexDist (doom_vertex_t* v);
+
 
 fixed_t R_ScaleFromGlobalAngle (angle_t visangle);
 
@@ -164,6 +175,10 @@ void R_Init (void);
 // Called by M_Responder.
 void R_SetViewSize (int blocks, int detail);
 
+// Called by the video device.
+void R_SetRenderResolution (int width, int height);
+void R_ForceLowDetail (boolean force);
+
 #endif
 //-----------------------------------------------------------------------------
 //
@@ -56,25 +56,28 @@ visplane_t*		floorplane;
 visplane_t*		ceilingplane;
 
 // ?
-#define MAXOPENINGS	SCREENWIDTH*64
+#define MAXOPENINGS	MAXRENDERWIDTH*64
 short			openings[MAXOPENINGS];
 short*			lastopening;
 
+// Visplane top value for a column it does not cover.
+#define PLANEUNSET	0xffff
+
 
 //
 // Clip values are the solid pixel bounding the range.
-//  floorclip starts out SCREENHEIGHT
+//  floorclip starts out viewheight
 //  ceilingclip starts out -1
 //
-short			floorclip[SCREENWIDTH];
-short			ceilingclip[SCREENWIDTH];
+short			floorclip[MAXRENDERWIDTH];
+short			ceilingclip[MAXRENDERWIDTH];
 
 //
 // spanstart holds the start of a plane span
 // initialized to 0 at start
 //
-int			spanstart[SCREENHEIGHT];
-int			spanstop[SCREENHEIGHT];
+int			spanstart[MAXRENDERHEIGHT];
+int			spanstop[MAXRENDERHEIGHT];
 
 //
 // texture mapping
@@ -82,15 +85,62 @@ int			spanstop[SCREENHEIGHT];
 lighttable_t**		planezlight;
 fixed_t			planeheight;
 
-fixed_t			yslope[SCREENHEIGHT];
-fixed_t			distscale[SCREENWIDTH];
+fixed_t			yslope[MAXRENDERHEIGHT];
+fixed_t			distscale[MAXRENDERWIDTH];
 fixed_t			basexscale;
 fixed_t			baseyscale;
 
-fixed_t			cachedheight[SCREENHEIGHT];
-fixed_t			cacheddistance[SCREENHEIGHT];
-fixed_t			cachedxstep[SCREENHEIGHT];
-fixed_t			cachedystep[SCREENHEIGHT];
+fixed_t			cachedheight[MAXRENDERHEIGHT];
+fixed_t			cacheddistance[MAXRENDERHEIGHT];
+fixed_t			cachedxstep[MAXRENDERHEIGHT];
+fixed_t			cachedystep[MAXRENDERHEIGHT];
+unsigned		cachedlight[MAXRENDERHEIGHT];
+
+// Fine angle of each column, for this frame's view.
+int			planeangle[MAXRENDERWIDTH];
+
+// Which flats planes have already cached for the level.
+// They are held at PU_LEVEL from then on, rather than
+//  being locked and released again for every plane.
+static byte*		flatpinned;
+
+extern int		numflats;
+
+
+//
+// sky
+// The sky texture is kept unpacked a column after another,
+//  already through the fullbright colormap, and each frame
+//  works out which sky column every screen column shows and
+//  which sky row every screen row shows, since neither
+//  changes from one sky plane to the next.
+//
+#define SKYHEIGHT	128
+
+static byte*		skycache;
+static int		skycachetexture = -1;
+static int		skywidthmask;
+
+static int		skyframe = -1;
+static int		skycolumns[MAXRENDERWIDTH];
+static byte		skyrows[MAXRENDERHEIGHT];
+
+extern byte*		ylookup[];
+extern int		columnofs[];
+extern int*		texturewidthmask;
+extern int		framecount;
+
+#ifdef NAOMI_DEBUG
+#include <stdint.h>
+
+int			r_flats_pinned;
+
+// Defined in main.c, for measuring sky drawing.
+uint64_t _get_time();
+
+int			r_sky_us;
+int			r_sky_columns;
+#endif
 
 
 
@@ -144,30 +194,32 @@ R_MapPlane
 	distance = cacheddistance[y] = FixedMul (planeheight, yslope[y]);
 	ds_xstep = cachedxstep[y] = FixedMul (distance,basexscale);
 	ds_ystep = cachedystep[y] = FixedMul (distance,baseyscale);
+
+	// The light row goes with the distance too.
+	index = distance >> LIGHTZSHIFT;
+	
+	if (index >= MAXLIGHTZ )
+	    index = MAXLIGHTZ-1;
+
+	cachedlight[y] = index;
     }
     else
     {
 	distance = cacheddistance[y];
 	ds_xstep = cachedxstep[y];
 	ds_ystep = cachedystep[y];
+	index = cachedlight[y];
     }
 	
     length = FixedMul (distance,distscale[x1]);
-    angle = (viewangle + xtoviewangle[x1])>>ANGLETOFINESHIFT;
+    angle = planeangle[x1];
     ds_xfrac = viewx + FixedMul(finecosine[angle], length);
     ds_yfrac = -viewy - FixedMul(finesine[angle], length);
 
     if (fixedcolormap)
 	ds_colormap = fixedcolormap;
     else
-    {
-	index = distance >> LIGHTZSHIFT;
-	
-	if (index >= MAXLIGHTZ )
-	    index = MAXLIGHTZ-1;
-
 	ds_colormap = planezlight[index];
-    }
 	
     ds_y = y;
     ds_x1 = x1;
@@ -178,6 +230,22 @@ R_MapPlane
 }
 
 
+//
+// R_ClearPlaneFlats
+// At level start, after the last level's flats went.
+//
+void R_ClearPlaneFlats (void)
+{
+    if (!flatpinned)
+	flatpinned = Z_Malloc (numflats, PU_STATIC, 0);
+
+    memset (flatpinned, 0, numflats);
+#ifdef NAOMI_DEBUG
+    r_flats_pinned = 0;
+#endif
+}
+
+
 //
 // R_ClearPlanes
 // At begining of frame.
@@ -200,6 +268,9 @@ void R_ClearPlanes (void)
     // texture calculation
     memset (cachedheight, 0, sizeof(cachedheight));
 
+    for (i=0 ; i<viewwidth ; i++)
+	planeangle[i] = (viewangle + xtoviewangle[i])>>ANGLETOFINESHIFT;
+
     // left to right mapping
     angle = (viewangle-ANG90)>>ANGLETOFINESHIFT;
 	
@@ -250,10 +321,10 @@ R_FindPlane
     check->height = height;
     check->picnum = picnum;
     check->lightlevel = lightlevel;
-    check->minx = SCREENWIDTH;
+    check->minx = MAXRENDERWIDTH;
     check->maxx = -1;
     
-    memset (check->top,0xff,sizeof(check->top));
+    memset (check->top,0xff,viewwidth*sizeof(*check->top));
 		
     return check;
 }
@@ -297,7 +368,7 @@ R_CheckPlane
     }
 
     for (x=intrl ; x<= intrh ; x++)
-	if (pl->top[x] != 0xff)
+	if (pl->top[x] != PLANEUNSET)
 	    break;
 
     if (x > intrh)
@@ -318,7 +389,7 @@ R_CheckPlane
     pl->minx = start;
     pl->maxx = stop;
 
-    memset (pl->top,0xff,sizeof(pl->top));
+    memset (pl->top,0xff,viewwidth*sizeof(*pl->top));
 		
     return pl;
 }
@@ -360,6 +431,134 @@ R_MakeSpans
 
 
 
+//
+// R_CacheSky
+// Unpacks the current sky texture, when it changes.
+//
+static void R_CacheSky (void)
+{
+    int		x;
+    int		y;
+    byte*	source;
+    byte*	dest;
+
+    if (skycache)
+	Z_Free (skycache);
+
+    skycachetexture = skytexture;
+    skywidthmask = texturewidthmask[skytexture];
+    skycache = Z_Malloc ((skywidthmask+1)*SKYHEIGHT, PU_STATIC, 0);
+
+    for (x=0 ; x<=skywidthmask ; x++)
+    {
+	source = R_GetColumn (skytexture, x);
+	dest = skycache + x*SKYHEIGHT;
+
+	// Sky is allways drawn full bright,
+	//  i.e. colormaps[0] is used.
+	// Because of this hack, sky is not affected
+	//  by INVUL inverse mapping.
+	for (y=0 ; y<SKYHEIGHT ; y++)
+	    dest[y] = colormaps[source[y]];
+    }
+}
+
+
+//
+// R_SetupSky
+// Maps screen columns and rows into the sky for this frame.
+//
+static void R_SetupSky (void)
+{
+    int		x;
+    int		y;
+    fixed_t	frac;
+    fixed_t	fracstep;
+
+    if (skytexture != skycachetexture)
+	R_CacheSky ();
+
+    skyframe = framecount;
+
+    for (x=0 ; x<viewwidth ; x++)
+	skycolumns[x] = (((viewangle + xtoviewangle[x])>>ANGLETOSKYSHIFT)
+			 & skywidthmask) * SKYHEIGHT;
+
+    fracstep = pspriteiscale>>detailshift;
+    frac = skytexturemid - centery*fracstep;
+
+    for (y=0 ; y<viewheight ; y++)
+    {
+	skyrows[y] = (frac>>FRACBITS)&(SKYHEIGHT-1);
+	frac += fracstep;
+    }
+}
+
+
+//
+// R_DrawSkyPlane
+//
+static void R_DrawSkyPlane (visplane_t* pl)
+{
+    int		x;
+    int		yl;
+    int		yh;
+    int		count;
+    int		stride;
+    byte*	source;
+    byte*	rows;
+    byte*	dest;
+#ifdef NAOMI_DEBUG
+    uint64_t	starttime = _get_time();
+#endif
+
+    if (skyframe != framecount || skytexture != skycachetexture)
+	R_SetupSky ();
+
+    stride = renderwidth;
+
+    for (x=pl->minx ; x <= pl->maxx ; x++)
+    {
+	yl = pl->top[x];
+	yh = pl->bottom[x];
+
+	if (yl > yh)
+	    continue;
+
+	source = skycache + skycolumns[x];
+	rows = skyrows + yl;
+	count = yh - yl;
+
+	if (detailshift)
+	{
+	    // Blocky mode, two pixels wide.
+	    dest = ylookup[yl] + columnofs[x<<1];
+	    do
+	    {
+		dest[0] = dest[1] = source[*rows++];
+		dest += stride;
+	    } while (count--);
+	}
+	else
+	{
+	    dest = ylookup[yl] + columnofs[x];
+	    do
+	    {
+		*dest = source[*rows++];
+		dest += stride;
+	    } while (count--);
+	}
+#ifdef NAOMI_DEBUG
+	r_sky_columns++;
+#endif
+    }
+
+#ifdef NAOMI_DEBUG
+    r_sky_us += (int)(_get_time() - starttime);
+#endif
+}
+
+
 //
 // R_DrawPlanes
 // At the end of each frame.
@@ -370,7 +569,8 @@ void R_DrawPlanes (void)
     int			light;
     int			x;
     int			stop;
-    int			angle;
+    int			flat;
+    int			lump;
 				
 #ifdef RANGECHECK
     if (ds_p - drawsegs > MAXDRAWSEGS)
@@ -395,34 +595,26 @@ void R_DrawPlanes (void)
 	// sky flat
 	if (pl->picnum == skyflatnum)
 	{
-	    dc_iscale = pspriteiscale>>detailshift;
-	    
-	    // Sky is allways drawn full bright,
-	    //  i.e. colormaps[0] is used.
-	    // Because of this hack, sky is not affected
-	    //  by INVUL inverse mapping.
-	    dc_colormap = colormaps;
-	    dc_texturemid = skytexturemid;
-	    for (x=pl->minx ; x <= pl->maxx ; x++)
-	    {
-		dc_yl = pl->top[x];
-		dc_yh = pl->bottom[x];
-
-		if (dc_yl <= dc_yh)
-		{
-		    angle = (viewangle + xtoviewangle[x])>>ANGLETOSKYSHIFT;
-		    dc_x = x;
-		    dc_source = R_GetColumn(skytexture, angle);
-		    colfunc ();
-		}
-	    }
+	    R_DrawSkyPlane (pl);
 	    continue;
 	}
 	
 	// regular flat
-	ds_source = W_CacheLumpNum(firstflat +
-				   flattranslation[pl->picnum],
-				   PU_STATIC);
+	// Animated flats can point it at a new lump any tic,
+	//  and other code can purge what it caches, so it is
+	//  checked every time.
+	flat = flattranslation[pl->picnum];
+	lump = firstflat + flat;
+	ds_source = lumpcache[lump];
+
+	if (!ds_source || !flatpinned[flat])
+	{
+	    ds_source = W_CacheLumpNum (lump, PU_LEVEL);
+	    flatpinned[flat] = true;
+#ifdef NAOMI_DEBUG
+	    r_flats_pinned++;
+#endif
+	}
 	
 	planeheight = abs(pl->height-viewz);
 	light = (pl->lightlevel >> LIGHTSEGSHIFT)+extralight;
@@ -435,8 +627,8 @@ void R_DrawPlanes (void)
 
 	planezlight = zlight[light];
 
-	pl->top[pl->maxx+1] = 0xff;
-	pl->top[pl->minx-1] = 0xff;
+	pl->top[pl->maxx+1] = PLANEUNSET;
+	pl->top[pl->minx-1] = PLANEUNSET;
 		
 	stop = pl->maxx + 1;
 
@@ -447,7 +639,5 @@ void R_DrawPlanes (void)
 			pl->top[x],
 			pl->bottom[x]);
 	}
-	
-	Z_ChangeTag (ds_source, PU_CACHE);
     }
 }
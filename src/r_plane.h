@@ -40,14 +40,15 @@ typedef void (*planefunction_t) (int top, int bottom);
 extern planefunction_t	floorfunc;
 extern planefunction_t	ceilingfunc_t;
 
-extern short		floorclip[SCREENWIDTH];
-extern short		ceilingclip[SCREENWIDTH];
+extern short		floorclip[MAXRENDERWIDTH];
+extern short		ceilingclip[MAXRENDERWIDTH];
 
-extern fixed_t		yslope[SCREENHEIGHT];
-extern fixed_t		distscale[SCREENWIDTH];
+extern fixed_t		yslope[MAXRENDERHEIGHT];
+extern fixed_t		distscale[MAXRENDERWIDTH];
 
 void R_InitPlanes (void);
 void R_ClearPlanes (void);
+void R_ClearPlaneFlats (void);
 
 void
 R_MapPlane
@@ -65,6 +66,15 @@ R_MakeSpans
 
 void R_DrawPlanes (void);
 
+#ifdef NAOMI_DEBUG
+// Time spent drawing sky, and sky columns drawn, this frame.
+extern int		r_sky_us;
+extern int		r_sky_columns;
+
+// Flats planes have cached at PU_LEVEL this level.
+extern int		r_flats_pinned;
+#endif
+
 visplane_t*
 R_FindPlane
 ( fixed_t	height,
@@ -32,6 +32,7 @@ rcsid[] = "$Id: r_segs.c,v 1.3 1997/01/29 20:10:19 b1 Exp $";
 #include <stdlib.h>
 
 #include "i_system.h"
+#include "z_zone.h"
 
 #include "doomdef.h"
 #include "doomstat.h"
@@ -39,6 +40,15 @@ rcsid[] = "$Id: r_segs.c,v 1.3 1997/01/29 20:10:19 b1 Exp $";
 #include "r_local.h"
 #include "r_sky.h"
 
+#ifdef NAOMI_DEBUG
+#include <stdint.h>
+
+// Defined in main.c, for measuring wall setup.
+uint64_t _get_time();
+
+int		r_storewall_us;
+#endif
+
 
 // OPTIMIZE: closed two sided lines as single sided
 
@@ -95,6 +105,171 @@ lighttable_t**	walllights;
 short*		maskedtexturecol;
 
 
+//
+// Deferred walls.
+// With deferwalls set, the seg loop only notes down each wall
+//  column, and R_DrawDeferredWalls draws them once the BSP walk
+//  is done, one texture at a time and within that one colormap
+//  at a time, so a texture's columns and its light tables stay
+//  in cache instead of being pushed out by node and seg data
+//  between every seg. Wall columns never overlap, so drawing
+//  them out of order gives the same picture.
+//
+boolean		deferwalls;
+
+typedef struct
+{
+    fixed_t		iscale;
+    fixed_t		texturemid;
+    int			column;
+    short		x;
+    short		yl;
+    short		yh;
+    short		next;
+    byte		colormap;	// which of colormaps
+
+} wallcolumn_t;
+
+// The light levels, then the invulnerability and black maps.
+#define WALLCOLORMAPS	(NUMCOLORMAPS+2)
+
+#define MAXWALLCOLUMNS	8192
+
+static wallcolumn_t	wallcolumns[MAXWALLCOLUMNS];
+static int		numwallcolumns;
+
+// First queued column of each texture, or -1,
+//  and the textures that have any queued.
+static short*		wallheads;
+static short*		walltextures;
+static int		numwalltextures;
+
+// The same again by colormap, for one texture's columns.
+static short		wallmapheads[WALLCOLORMAPS];
+static byte		wallmaps[WALLCOLORMAPS];
+static int		numwallmaps;
+
+extern int		numtextures;
+
+#ifdef NAOMI_DEBUG
+int		r_deferwalls_us;
+#endif
+
+
+//
+// R_DrawDeferredWalls
+// Draws every wall column queued so far.
+//
+void R_DrawDeferredWalls (void)
+{
+    int			i;
+    int			m;
+    int			tex;
+    int			map;
+    int			c;
+    int			next;
+    wallcolumn_t*	wc;
+#ifdef NAOMI_DEBUG
+    uint64_t		starttime = _get_time();
+#endif
+
+    for (i=0 ; i<numwalltextures ; i++)
+    {
+	tex = walltextures[i];
+
+	// Sort the texture's columns out by colormap.
+	for (c = wallheads[tex] ; c != -1 ; c = next)
+	{
+	    wc = &wallcolumns[c];
+	    next = wc->next;
+	    if (wallmapheads[wc->colormap] == -1)
+		wallmaps[numwallmaps++] = wc->colormap;
+	    wc->next = wallmapheads[wc->colormap];
+	    wallmapheads[wc->colormap] = c;
+	}
+	wallheads[tex] = -1;
+
+	for (m=0 ; m<numwallmaps ; m++)
+	{
+	    map = wallmaps[m];
+	    dc_colormap = colormaps + map*256;
+
+	    for (c = wallmapheads[map] ; c != -1 ; c = wc->next)
+	    {
+		wc = &wallcolumns[c];
+		dc_iscale = wc->iscale;
+		dc_texturemid = wc->texturemid;
+		dc_x = wc->x;
+		dc_yl = wc->yl;
+		dc_yh = wc->yh;
+		dc_source = R_GetColumn(tex,wc->column);
+		colfunc ();
+	    }
+	    wallmapheads[map] = -1;
+	}
+	numwallmaps = 0;
+    }
+
+    numwalltextures = 0;
+    numwallcolumns = 0;
+
+#ifdef NAOMI_DEBUG
+    r_deferwalls_us += (int)(_get_time() - starttime);
+#endif
+}
+
+
+//
+// R_DrawWallColumn
+// Draws, or queues when deferring, a column of a wall tier.
+// The rest of the dc_ state is already set up by the seg loop.
+//
+static void
+R_DrawWallColumn
+( int		texture,
+  int		texturecolumn )
+{
+    wallcolumn_t*	wc;
+    int			i;
+
+    if (!deferwalls)
+    {
+	dc_source = R_GetColumn(texture,texturecolumn);
+	colfunc ();
+	return;
+    }
+
+    if (!wallheads)
+    {
+	wallheads = Z_Malloc (numtextures*sizeof(*wallheads), PU_STATIC, 0);
+	walltextures = Z_Malloc (numtextures*sizeof(*walltextures), PU_STATIC, 0);
+	for (i=0 ; i<numtextures ; i++)
+	    wallheads[i] = -1;
+	for (i=0 ; i<WALLCOLORMAPS ; i++)
+	    wallmapheads[i] = -1;
+    }
+
+    if (numwallcolumns == MAXWALLCOLUMNS)
+	R_DrawDeferredWalls ();
+
+    if (wallheads[texture] == -1)
+	walltextures[numwalltextures++] = texture;
+
+    // Prepending reverses each texture's columns, which
+    //  doesn't matter since none of them overlap.
+    wc = &wallcolumns[numwallcolumns];
+    wc->colormap = (dc_colormap - colormaps) >> 8;
+    wc->iscale = dc_iscale;
+    wc->texturemid = dc_texturemid;
+    wc->column = texturecolumn;
+    wc->x = dc_x;
+    wc->yl = dc_yl;
+    wc->yh = dc_yh;
+    wc->next = wallheads[texture];
+    wallheads[texture] = numwallcolumns++;
+}
+
+
 
 //
 // R_RenderMaskedSegRange
@@ -283,8 +458,7 @@ void R_RenderSegLoop (void)
 	    dc_yl = yl;
 	    dc_yh = yh;
 	    dc_texturemid = rw_midtexturemid;
-	    dc_source = R_GetColumn(midtexture,texturecolumn);
-	    colfunc ();
+	    R_DrawWallColumn (midtexture,texturecolumn);
 	    ceilingclip[rw_x] = viewheight;
 	    floorclip[rw_x] = -1;
 	}
@@ -305,8 +479,7 @@ void R_RenderSegLoop (void)
 		    dc_yl = yl;
 		    dc_yh = mid;
 		    dc_texturemid = rw_toptexturemid;
-		    dc_source = R_GetColumn(toptexture,texturecolumn);
-		    colfunc ();
+		    R_DrawWallColumn (toptexture,texturecolumn);
 		    ceilingclip[rw_x] = mid;
 		}
 		else
@@ -334,9 +507,7 @@ void R_RenderSegLoop (void)
 		    dc_yl = mid;
 		    dc_yh = yh;
 		    dc_texturemid = rw_bottomtexturemid;
-		    dc_source = R_GetColumn(bottomtexture,
-					    texturecolumn);
-		    colfunc ();
+		    R_DrawWallColumn (bottomtexture,texturecolumn);
 		    floorclip[rw_x] = mid;
 		}
 		else
@@ -381,31 +552,40 @@ R_StoreWallRange
     angle_t		distangle, offsetangle;
     fixed_t		vtop;
     int			lightnum;
+    segrender_t*	sr;
+#ifdef NAOMI_DEBUG
+    uint64_t		starttime;
+#endif
 
     // don't overflow and crash
     if (ds_p == &drawsegs[MAXDRAWSEGS])
 	return;		
+
+#ifdef NAOMI_DEBUG
+    starttime = _get_time();
+#endif
 		
 #ifdef RANGECHECK
     if (start >=viewwidth || start > stop)
 	I_Error ("Bad R_RenderWallRange: %i to %i", start , stop);
 #endif
     
-    sidedef = curline->sidedef;
-    linedef = curline->linedef;
+    sr = &segrender[curline - segs];
+    sidedef = sr->sidedef;
+    linedef = sr->linedef;
 
     // mark the segment as visible for auto map
     linedef->flags |= ML_MAPPED;
     
     // calculate rw_distance for scale calculation
-    rw_normalangle = curline->angle + ANG90;
+    rw_normalangle = sr->normalangle;
     offsetangle = abs(rw_normalangle-rw_angle1);
     
     if (offsetangle > ANG90)
 	offsetangle = ANG90;
 
     distangle = ANG90 - offsetangle;
-    hyp = R_PointToDist (curline->v1->x, curline->v1->y);
+    hyp = R_VertexDist (curline->v1);
     sineval = finesine[distangle>>ANGLETOFINESHIFT];
     rw_distance = FixedMul (hyp, sineval);
 		
@@ -459,7 +639,7 @@ R_StoreWallRange
 	midtexture = texturetranslation[sidedef->midtexture];
 	// a single sided line is terminal, so it must mark ends
 	markfloor = markceiling = true;
-	if (linedef->flags & ML_DONTPEGBOTTOM)
+	if (sr->flags & SEGF_DONTPEGBOTTOM)
 	{
 	    vtop = frontsector->floorheight +
 		textureheight[sidedef->midtexture];
@@ -571,7 +751,7 @@ R_StoreWallRange
 	{
 	    // top texture
 	    toptexture = texturetranslation[sidedef->toptexture];
-	    if (linedef->flags & ML_DONTPEGTOP)
+	    if (sr->flags & SEGF_DONTPEGTOP)
 	    {
 		// top of texture at top
 		rw_toptexturemid = worldtop;
@@ -591,7 +771,7 @@ R_StoreWallRange
 	    // bottom texture
 	    bottomtexture = texturetranslation[sidedef->bottomtexture];
 
-	    if (linedef->flags & ML_DONTPEGBOTTOM )
+	    if (sr->flags & SEGF_DONTPEGBOTTOM)
 	    {
 		// bottom of texture at bottom
 		// top of texture at top
@@ -641,12 +821,8 @@ R_StoreWallRange
 	// OPTIMIZE: get rid of LIGHTSEGSHIFT globally
 	if (!fixedcolormap)
 	{
-	    lightnum = (frontsector->lightlevel >> LIGHTSEGSHIFT)+extralight;
-
-	    if (curline->v1->y == curline->v2->y)
-		lightnum--;
-	    else if (curline->v1->x == curline->v2->x)
-		lightnum++;
+	    lightnum = (frontsector->lightlevel >> LIGHTSEGSHIFT)+extralight
+		+ sr->lightadjust;
 
 	    if (lightnum < 0)		
 		walllights = scalelight[0];
@@ -742,5 +918,9 @@ R_StoreWallRange
 	ds_p->bsilheight = MAXINT;
     }
     ds_p++;
+
+#ifdef NAOMI_DEBUG
+    r_storewall_us += (int)(_get_time() - starttime);
+#endif
 }
 
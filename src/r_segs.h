@@ -35,6 +35,20 @@ R_RenderMaskedSegRange
   int		x1,
   int		x2 );
 
+// Queue wall columns up and draw them a texture at a time
+//  from R_DrawDeferredWalls, instead of as the BSP walk goes.
+extern boolean	deferwalls;
+
+void R_DrawDeferredWalls (void);
+
+#ifdef NAOMI_DEBUG
+// Time spent drawing deferred walls so far this frame.
+extern int	r_deferwalls_us;
+
+// Time spent in R_StoreWallRange so far this frame.
+extern int	r_storewall_us;
+#endif
+
 
 #endif
 //-----------------------------------------------------------------------------
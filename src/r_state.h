@@ -53,6 +53,7 @@ extern lighttable_t*	colormaps;
 
 extern int		viewwidth;
 extern int		scaledviewwidth;
+extern int		scaledviewheight;
 extern int		viewheight;
 
 extern int		firstflat;
@@ -80,6 +81,7 @@ extern doom_vertex_t*	vertexes;
 
 extern int		numsegs;
 extern seg_t*		segs;
+extern segrender_t*	segrender;
 
 extern int		numsectors;
 extern sector_t*	sectors;
@@ -112,7 +114,7 @@ extern player_t*	viewplayer;
 extern angle_t		clipangle;
 
 extern int		viewangletox[FINEANGLES/2];
-extern angle_t		xtoviewangle[SCREENWIDTH+1];
+extern angle_t		xtoviewangle[MAXRENDERWIDTH+1];
 //extern fixed_t		finetangent[FINEANGLES/2];
 
 extern fixed_t		rw_distance;
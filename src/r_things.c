@@ -78,8 +78,8 @@ lighttable_t**	spritelights;
 
 // constant arrays
 //  used for psprite clipping and initializing clipping
-short		negonearray[SCREENWIDTH];
-short		screenheightarray[SCREENWIDTH];
+short		negonearray[MAXRENDERWIDTH];
+short		screenheightarray[MAXRENDERWIDTH];
 
 
 //
@@ -300,7 +300,7 @@ void R_InitSprites (char** namelist)
 {
     int		i;
 	
-    for (i=0 ; i<SCREENWIDTH ; i++)
+    for (i=0 ; i<MAXRENDERWIDTH ; i++)
     {
 	negonearray[i] = -1;
     }
@@ -478,10 +478,28 @@ void R_ProjectSprite (mobj_t* thing)
     
     angle_t		ang;
     fixed_t		iscale;
+
+    fixed_t		thingx;
+    fixed_t		thingy;
+    fixed_t		thingz;
+
+    // where it is between tics
+    if (uncappedframes)
+    {
+	thingx = R_LERP(thing->oldx, thing->x);
+	thingy = R_LERP(thing->oldy, thing->y);
+	thingz = R_LERP(thing->oldz, thing->z);
+    }
+    else
+    {
+	thingx = thing->x;
+	thingy = thing->y;
+	thingz = thing->z;
+    }
     
     // transform the origin point
-    tr_x = thing->x - viewx;
-    tr_y = thing->y - viewy;
+    tr_x = thingx - viewx;
+    tr_y = thingy - viewy;
 	
     gxt = FixedMul(tr_x,viewcos); 
     gyt = -FixedMul(tr_y,viewsin);
@@ -519,7 +537,7 @@ void R_ProjectSprite (mobj_t* thing)
     if (sprframe->rotate)
     {
 	// choose a different rotation based on player view
-	ang = R_PointToAngle (thing->x, thing->y);
+	ang = R_PointToAngle (thingx, thingy);
 	rot = (ang-thing->angle+(unsigned)(ANG45/2)*9)>>29;
 	lump = sprframe->lump[rot];
 	flip = (boolean)sprframe->flip[rot];
@@ -550,10 +568,10 @@ void R_ProjectSprite (mobj_t* thing)
     vis = R_NewVisSprite ();
     vis->mobjflags = thing->flags;
     vis->scale = xscale<<detailshift;
-    vis->gx = thing->x;
-    vis->gy = thing->y;
-    vis->gz = thing->z;
-    vis->gzt = thing->z + spritetopoffset[lump];
+    vis->gx = thingx;
+    vis->gy = thingy;
+    vis->gz = thingz;
+    vis->gzt = thingz + spritetopoffset[lump];
     vis->texturemid = vis->gzt - viewz;
     vis->x1 = x1 < 0 ? 0 : x1;
     vis->x2 = x2 >= viewwidth ? viewwidth-1 : x2;	
@@ -836,14 +854,77 @@ void R_SortVisSprites (void)
 
 
 
+//
+// Drawsegs that can clip sprites are indexed by the strips
+//  of screen columns they cover, a bit per drawseg, so each
+//  sprite only looks at the ones reaching its own strips
+//  instead of every drawseg in the frame.
+//
+#define DSSTRIPSHIFT	4
+#define DSSTRIPS	((MAXRENDERWIDTH>>DSSTRIPSHIFT)+1)
+#define DSBITS		32
+#define DSWORDS		((MAXDRAWSEGS+DSBITS-1)/DSBITS)
+
+static unsigned int	dsstrips[DSSTRIPS][DSWORDS];
+
+
+//
+// R_IndexDrawSegs
+//
+static void R_IndexDrawSegs (void)
+{
+    drawseg_t*		ds;
+    int			i;
+    int			strip;
+
+    memset (dsstrips, 0, sizeof(dsstrips));
+
+    for (ds=drawsegs ; ds<ds_p ; ds++)
+    {
+	if (!ds->silhouette && !ds->maskedtexturecol)
+	    continue;
+
+	i = ds - drawsegs;
+	for (strip = ds->x1>>DSSTRIPSHIFT ; strip <= ds->x2>>DSSTRIPSHIFT ; strip++)
+	    dsstrips[strip][i/DSBITS] |= 1u << (i%DSBITS);
+    }
+}
+
+
+//
+// R_NextClipSeg
+// Takes the highest numbered drawseg left in segbits,
+//  or returns NULL when there are none.
+//
+static drawseg_t*
+R_NextClipSeg
+( unsigned int*	segbits,
+  int*		word )
+{
+    int		i;
+
+    while (!segbits[*word])
+    {
+	if (--*word < 0)
+	    return NULL;
+    }
+
+    i = DSBITS-1 - __builtin_clz (segbits[*word]);
+    segbits[*word] &= ~(1u << i);
+    return &drawsegs[*word*DSBITS + i];
+}
+
+
 //
 // R_DrawSprite
 //
 void R_DrawSprite (vissprite_t* spr)
 {
     drawseg_t*		ds;
-    short		clipbot[SCREENWIDTH];
-    short		cliptop[SCREENWIDTH];
+    short		clipbot[MAXRENDERWIDTH];
+    short		cliptop[MAXRENDERWIDTH];
+    unsigned int	segbits[DSWORDS];
+    int			word;
     int			x;
     int			r1;
     int			r2;
@@ -853,11 +934,18 @@ void R_DrawSprite (vissprite_t* spr)
 		
     for (x = spr->x1 ; x<=spr->x2 ; x++)
 	clipbot[x] = cliptop[x] = -2;
+
+    // Gather the drawsegs in the sprite's strips.
+    memcpy (segbits, dsstrips[spr->x1>>DSSTRIPSHIFT], sizeof(segbits));
+    for (x = (spr->x1>>DSSTRIPSHIFT)+1 ; x <= spr->x2>>DSSTRIPSHIFT ; x++)
+	for (word=0 ; word<DSWORDS ; word++)
+	    segbits[word] |= dsstrips[x][word];
     
     // Scan drawsegs from end to start for obscuring segs.
     // The first drawseg that has a greater scale
     //  is the clip seg.
-    for (ds=ds_p-1 ; ds >= drawsegs ; ds--)
+    word = DSWORDS-1;
+    while ( (ds = R_NextClipSeg (segbits, &word)) )
     {
 	// determine if the drawseg obscures the sprite
 	if (ds->x1 > spr->x2
@@ -964,6 +1052,8 @@ void R_DrawMasked (void)
 
     if (vissprite_p > vissprites)
     {
+	R_IndexDrawSegs ();
+
 	// draw all vissprites back to front
 	for (spr = vsprsortedhead.next ;
 	     spr != &vsprsortedhead ;
@@ -36,8 +36,8 @@ extern vissprite_t	vsprsortedhead;
 
 // Constant arrays used for psprite clipping
 //  and initializing clipping.
-extern short		negonearray[SCREENWIDTH];
-extern short		screenheightarray[SCREENWIDTH];
+extern short		negonearray[MAXRENDERWIDTH];
+extern short		screenheightarray[MAXRENDERWIDTH];
 
 // vars for R_DrawMaskedColumn
 extern short*		mfloorclip;
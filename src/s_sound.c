@@ -100,6 +100,15 @@ typedef struct
 
     // handle of the sound being played
     int		handle;
+
+    // parameters last handed to the sound device
+    int		vol;
+    int		sep;
+    int		pitch;
+
+    // origin position those parameters were computed for
+    fixed_t	originx;
+    fixed_t	originy;
     
 } channel_t;
 
@@ -107,6 +116,32 @@ typedef struct
 // the set of channels available
 static channel_t*	channels;
 
+// parameter updates collected for a single device call
+static soundparams_t*	batch;
+
+// Listener state the channel parameters were last computed for.
+// If neither the listener nor a source moved, the source's
+//  parameters can't have changed either.
+static fixed_t		lastlistenerx;
+static fixed_t		lastlistenery;
+static angle_t		lastlistenerangle;
+static int		lastsfxvolume = -1;
+
+// Changes smaller than this aren't worth telling the device about.
+#define S_SEP_THRESHOLD		4
+
+#ifdef NAOMI
+#include <stdint.h>
+
+// Defined in main.c, for measuring update cost.
+uint64_t _get_time();
+
+// Per-frame positional update statistics, for the debug overlay.
+int			s_update_us;
+int			s_update_computed;
+int			s_update_submitted;
+#endif
+
 // These are not used, but should be (menu).
 // Maximum volume of a sound effect.
 // Internal default is max out of 0-15.
@@ -184,6 +219,9 @@ void S_Init
   // Free all channels for use
   for (i=0 ; i<numChannels ; i++)
     channels[i].sfxinfo = 0;
+
+  batch =
+    (soundparams_t *) Z_Malloc(numChannels*sizeof(soundparams_t), PU_STATIC, 0);
   
   // no sounds are playing, and they are not mus_paused
   mus_paused = 0;
@@ -393,7 +431,15 @@ S_StartSoundAtVolume
 				       volume,
 				       sep,
 				       pitch,
-				       priority);
+				       priority,
+				       origin && origin != players[consoleplayer].mo);
+
+  // remember what the device has, so updates can be skipped
+  channels[cnum].vol = volume;
+  channels[cnum].sep = sep;
+  channels[cnum].pitch = pitch;
+  channels[cnum].originx = origin ? origin->x : 0;
+  channels[cnum].originy = origin ? origin->y : 0;
 }	
 
 void
@@ -525,11 +571,19 @@ void S_UpdateSounds(void* listener_p)
     int		volume;
     int		sep;
     int		pitch;
+    int		numbatch;
+    boolean	listenermoved;
     sfxinfo_t*	sfx;
     channel_t*	c;
+    mobj_t*	origin;
     
     mobj_t*	listener = (mobj_t*)listener_p;
 
+#ifdef NAOMI
+    uint64_t	starttime = _get_time();
+
+    s_update_computed = 0;
+#endif
 
     
     // Clean up unused data.
@@ -551,6 +605,14 @@ void S_UpdateSounds(void* listener_p)
 	}
 	nextcleanup = gametic + 15;
     }*/
+
+    listenermoved = !listener
+	|| listener->x != lastlistenerx
+	|| listener->y != lastlistenery
+	|| listener->angle != lastlistenerangle
+	|| snd_SfxVolume != lastsfxvolume;
+
+    numbatch = 0;
     
     for (cnum=0 ; cnum<numChannels ; cnum++)
     {
@@ -561,42 +623,74 @@ void S_UpdateSounds(void* listener_p)
 	{
 	    if (I_SoundIsPlaying(c->handle))
 	    {
-		// initialize parameters
-		volume = snd_SfxVolume;
-		pitch = NORM_PITCH;
-		sep = NORM_SEP;
-
-		if (sfx->link)
+		// check non-local sounds for distance clipping
+		//  or modify their params
+		if (c->origin && listener_p != c->origin)
 		{
-		    pitch = sfx->pitch;
-		    volume += sfx->volume;
-		    if (volume < 1)
+		    origin = (mobj_t *) c->origin;
+
+		    // nothing moved, so nothing changed
+		    if (!listenermoved
+			&& origin->x == c->originx
+			&& origin->y == c->originy)
 		    {
-			S_StopChannel(cnum);
 			continue;
 		    }
-		    else if (volume > snd_SfxVolume)
+
+		    c->originx = origin->x;
+		    c->originy = origin->y;
+
+		    // initialize parameters
+		    volume = snd_SfxVolume;
+		    pitch = NORM_PITCH;
+		    sep = NORM_SEP;
+
+		    if (sfx->link)
 		    {
-			volume = snd_SfxVolume;
+			pitch = sfx->pitch;
+			volume += sfx->volume;
+			if (volume < 1)
+			{
+			    S_StopChannel(cnum);
+			    continue;
+			}
+			else if (volume > snd_SfxVolume)
+			{
+			    volume = snd_SfxVolume;
+			}
 		    }
-		}
 
-		// check non-local sounds for distance clipping
-		//  or modify their params
-		if (c->origin && listener_p != c->origin)
-		{
 		    audible = S_AdjustSoundParams(listener,
-						  c->origin,
+						  origin,
 						  &volume,
 						  &sep,
 						  &pitch);
+#ifdef NAOMI
+		    s_update_computed++;
+#endif
 		    
 		    if (!audible)
 		    {
 			S_StopChannel(cnum);
 		    }
-		    else
-			I_UpdateSoundParams(c->handle, volume, sep, pitch);
+		    else if (volume != c->vol
+			     || pitch != c->pitch
+			     || abs(sep - c->sep) >= S_SEP_THRESHOLD)
+		    {
+			c->vol = volume;
+			c->sep = sep;
+			c->pitch = pitch;
+
+			batch[numbatch].handle = c->handle;
+			batch[numbatch].vol = volume;
+			batch[numbatch].sep = sep;
+			batch[numbatch].pitch = pitch;
+			numbatch++;
+		    }
+		}
+		else if (sfx->link && sfx->volume + snd_SfxVolume < 1)
+		{
+		    S_StopChannel(cnum);
 		}
 	    }
 	    else
@@ -607,6 +701,24 @@ void S_UpdateSounds(void* listener_p)
 	    }
 	}
     }
+
+    // hand everything that changed to the device in one go
+    if (numbatch)
+	I_UpdateSoundParamsBatch(batch, numbatch);
+
+    if (listener)
+    {
+	lastlistenerx = listener->x;
+	lastlistenery = listener->y;
+	lastlistenerangle = listener->angle;
+    }
+    lastsfxvolume = snd_SfxVolume;
+
+#ifdef NAOMI
+    s_update_submitted = numbatch;
+    s_update_us = (int)(_get_time() - starttime);
+#endif
+
     // kill music if it is a single-play && finished
     // if (	mus_playing
     //      && !I_QrySongPlaying(mus_playing->handle)
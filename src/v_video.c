@@ -45,6 +45,9 @@ byte*				screens[5];
  
 int				dirtybox[4]; 
 
+int				dirtyleft[DIRTYBANDS];
+int				dirtyright[DIRTYBANDS];
+
 
 
 // Now where did these came from?
@@ -146,9 +149,57 @@ V_MarkRect
   int		width,
   int		height ) 
 { 
+    int		band;
+    int		lastband;
+
     M_AddToBox (dirtybox, x, y); 
     M_AddToBox (dirtybox, x+width-1, y+height-1); 
+
+    // clip to the screen
+    if (x < 0)
+    {
+	width += x;
+	x = 0;
+    }
+    if (y < 0)
+    {
+	height += y;
+	y = 0;
+    }
+    if (x+width > SCREENWIDTH)
+	width = SCREENWIDTH-x;
+    if (y+height > SCREENHEIGHT)
+	height = SCREENHEIGHT-y;
+    if (width <= 0 || height <= 0)
+	return;
+
+    lastband = (y+height-1)/DIRTYBANDHEIGHT;
+    for (band = y/DIRTYBANDHEIGHT ; band <= lastband ; band++)
+    {
+	if (dirtyleft[band] == dirtyright[band])
+	{
+	    dirtyleft[band] = x;
+	    dirtyright[band] = x+width;
+	    continue;
+	}
+	if (x < dirtyleft[band])
+	    dirtyleft[band] = x;
+	if (x+width > dirtyright[band])
+	    dirtyright[band] = x+width;
+    }
 } 
+
+
+//
+// V_ClearDirty
+//
+void V_ClearDirty (void)
+{
+    int		band;
+
+    for (band = 0 ; band < DIRTYBANDS ; band++)
+	dirtyleft[band] = dirtyright[band] = 0;
+}
  
 
 //
@@ -182,14 +233,24 @@ V_CopyRect
 	I_Error ("Bad V_CopyRect");
     }
 #endif 
-    V_MarkRect (destx, desty, width, height); 
+    if (!destscrn)
+	V_MarkRect (destx, desty, width, height); 
 	 
     src = screens[srcscrn]+SCREENWIDTH*srcy+srcx; 
     dest = screens[destscrn]+SCREENWIDTH*desty+destx; 
 
     for ( ; height>0 ; height--) 
     { 
-	memcpy (dest, src, width); 
+	if (!destscrn && viewbuffer)
+	{
+	    int		i;
+
+	    // Keep the view key color for the view window.
+	    for (i=0 ; i<width ; i++)
+		dest[i] = viewkeymap[src[i]];
+	}
+	else
+	    memcpy (dest, src, width); 
 	src += SCREENWIDTH; 
 	dest += SCREENWIDTH; 
     } 
@@ -251,7 +312,16 @@ V_DrawPatch
 	    dest = desttop + column->topdelta*SCREENWIDTH; 
 	    count = column->length;
 			 
-	    while (count--)
+	    if (!scrn && viewbuffer)
+	    {
+		// Keep the view key color for the view window.
+		while (count--)
+		{
+		    *dest = viewkeymap[*source++];
+		    dest += SCREENWIDTH;
+		}
+	    }
+	    else while (count--)
 	    { 
 		*dest = *source++; 
 		dest += SCREENWIDTH; 
@@ -316,7 +386,15 @@ V_DrawPatchFlipped
 	    dest = desttop + column->topdelta*SCREENWIDTH; 
 	    count = column->length; 
 			 
-	    while (count--) 
+	    if (!scrn && viewbuffer)
+	    {
+		while (count--)
+		{
+		    *dest = viewkeymap[*source++];
+		    dest += SCREENWIDTH;
+		}
+	    }
+	    else while (count--) 
 	    { 
 		*dest = *source++; 
 		dest += SCREENWIDTH; 
@@ -496,4 +574,6 @@ void V_Init (void)
     for (i=0 ; i<4 ; i++)
         screens[i] = base + i*SCREENWIDTH*SCREENHEIGHT;
 #endif
+
+    V_MarkRect (0, 0, SCREENWIDTH, SCREENHEIGHT);
 }
@@ -48,6 +48,15 @@ extern	byte*		screens[5];
 
 extern  int	dirtybox[4];
 
+// Dirty tracking for screen 0, in bands of rows with a
+//  column extent per band, so the video device only has
+//  to push the parts of the screen that changed.
+#define DIRTYBANDHEIGHT	8
+#define DIRTYBANDS	((SCREENHEIGHT+DIRTYBANDHEIGHT-1)/DIRTYBANDHEIGHT)
+
+extern	int	dirtyleft[DIRTYBANDS];
+extern	int	dirtyright[DIRTYBANDS];	// exclusive, equal to left if clean
+
 extern	byte	gammatable[5][256];
 extern	int	usegamma;
 
@@ -111,6 +120,9 @@ V_MarkRect
   int		width,
   int		height );
 
+// Forgets about everything marked so far.
+void V_ClearDirty (void);
+
 #endif
 //-----------------------------------------------------------------------------
 //
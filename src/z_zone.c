@@ -59,6 +59,10 @@ typedef struct
 
 memzone_t*	mainzone;
 
+#ifdef NAOMI_DEBUG
+int		z_tagchanges;
+#endif
+
 
 
 //
@@ -442,6 +446,9 @@ Z_ChangeTag2
 	I_Error ("Z_ChangeTag: an owner is required for purgable blocks");
 
     block->tag = tag;
+#ifdef NAOMI_DEBUG
+    z_tagchanges++;
+#endif
 }
 
 
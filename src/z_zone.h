@@ -54,6 +54,11 @@ void    Z_CheckHeap (void);
 void    Z_ChangeTag2 (void *ptr, int tag);
 int     Z_FreeMemory (void);
 
+#ifdef NAOMI_DEBUG
+// Tag changes so far, for the debug overlay.
+extern int	z_tagchanges;
+#endif
+
 
 typedef struct memblock_s
 {